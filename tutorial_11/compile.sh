@@ -1,2 +1,3 @@
 /usr/local/bin/glslc shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
-/usr/local/bin/glslc shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
\ No newline at end of file
+/usr/local/bin/glslc shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
+/usr/local/bin/glslc shaders/simple_compute.comp -o shaders/simple_compute.comp.spv
\ No newline at end of file
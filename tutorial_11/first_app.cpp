@@ -1,12 +1,18 @@
 #include "first_app.hpp"
 #include "simple_renderer_system.hpp"
+#include "lve_shader_library.hpp"
+#include "lve_shader_watcher.hpp"
 #include <stdexcept>
 #include <array>
 #include <glm/gtc/constants.hpp>
 
 namespace lve {
 
-FirstApp::FirstApp() {};
+FirstApp::FirstApp() {
+  // Frames in flight may still draw from the range of a model that was just dropped.
+  geometry_pool_.setDeferRelease(
+      [this](std::shared_ptr<void> range) { lve_renderer_.deferRelease(std::move(range)); });
+};
 
 void FirstApp::init() {
   loadGameObjects();
@@ -14,10 +20,25 @@ void FirstApp::init() {
 
 FirstApp::~FirstApp() {}
 void FirstApp::run() {
-  SimpleRendererSystem simple_render_system{lve_device_, lve_renderer_.getSwapChainRenderPass()};
+  SimpleRendererSystem simple_render_system{
+      lve_device_, lve_renderer_.getSwapChainRenderPass(), lve_renderer_.getRenderPassCompatibility(), kVertexFormat_};
+  // Edit shaders/*.vert|frag while running, they're recompiled and swapped in without a restart.
+  LveShaderWatcher shader_watcher{"shaders"};
   while (!lve_window_.ShouldClose()) {
     glfwPollEvents();
+    auto changed_shaders = shader_watcher.takeChangedFiles();
+    for (const auto &file : changed_shaders) {
+      lve_device_.shaderLibrary().invalidate(file);
+    }
+    simple_render_system.OnShadersChanged(changed_shaders, pipeline_compiler_);
     if(auto command_buffer = lve_renderer_.beginFrame()) {
+      // No-op unless the swap chain formats changed.
+      simple_render_system.UpdateRenderPass(
+          lve_renderer_.getSwapChainRenderPass(), lve_renderer_.getRenderPassCompatibility());
+      // Frame boundary, safe to swap. The old pipeline is destroyed once no frame uses it.
+      for (auto &old_pipeline : simple_render_system.SwapReloadedPipeline()) {
+        lve_renderer_.deferRelease(std::move(old_pipeline));
+      }
       // Splitting beginSwapChainRenderPass and beginFrame, in order
       // to enable multiple render passes in the future(e.g reflection, shadow, postprocess).
       lve_renderer_.beginSwapChainRenderPass(command_buffer);
@@ -36,13 +57,15 @@ void FirstApp::run() {
 void FirstApp::loadGameObjects() {
   // Initialize a vector of Vertex, but only give input to vec2/position.
   // to the position.
-  std::vector<LveModel::Vertex> vertices {
+  LveModel::Builder builder{};
+  builder.vertexFormat = kVertexFormat_;
+  builder.addTriangleList({
     {{0.0, -0.5}, {1.0f, 0.0f, 0.0f}},
     {{0.5, 0.5}, {0.f, 1.0f, 0.0f}},
     {{-0.5, 0.5}, {0.0f, 0.0f, 1.0f}}
-  };
+  });
   // Shared so that multiple game objects can use the same model.
-  auto lve_model = std::make_shared<LveModel>(lve_device_, vertices);
+  auto lve_model = std::make_shared<LveModel>(lve_device_, geometry_pool_, builder);
   LveGameObject triangle = LveGameObject::createGameObject();
   triangle.lve_model_ = lve_model;
   triangle.color_ = {0.1f, 0.8f, 0.1f};
@@ -2,9 +2,11 @@
 
 #include "lve_device.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
 #include "lve_renderer.hpp"
 #include "lve_window.hpp"
 #include "lve_game_object.hpp"
+#include "lve_geometry_pool.hpp"
 
 #include <iostream>
 
@@ -15,6 +17,8 @@ class FirstApp {
     void init();
     static constexpr int kWidth_ = 800;
     static constexpr int kHeight_ = 600;
+    // 8 byte vertices, the scene's positions are all in [-1, 1].
+    static constexpr VertexFormat kVertexFormat_ = VertexFormat::kSnorm16;
     FirstApp();
     ~FirstApp();
     FirstApp(const FirstApp &) = delete;
@@ -25,8 +29,14 @@ class FirstApp {
 
     LveWindow lve_window_{kWidth_, kHeight_, "Hi Vulkan!"};
     LveDevice lve_device_{lve_window_};
-    std::vector<LveGameObject> lve_game_objects_;
+    // Vertices and indices of every model, declared before the game objects so it outlives them.
+    LveGeometryPool geometry_pool_{lve_device_, vertexStride(kVertexFormat_)};
+    // Declared before the game objects too, the pool ranges of dropped models are freed through
+    // its deferRelease.
     LveRenderer lve_renderer_{lve_window_, lve_device_};
+    std::vector<LveGameObject> lve_game_objects_;
+    // Rebuilds pipelines off the render loop on shader hot reload.
+    LvePipelineCompiler pipeline_compiler_{lve_device_, 1};
 };
 
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "headless_app.hpp"
+#include "simple_compute_system.hpp"
+#include "simple_renderer_system.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <glm/gtc/constants.hpp>
+
+namespace lve {
+
+namespace {
+
+// Mesh optimizer benchmark, not drawn. A grid of quads as a shuffled triangle soup(what an
+// unoptimized asset looks like): Builder welds the corners the quads share, optimize reorders it.
+void ReportMeshOptimization(int grid_size) {
+  std::vector<std::array<LveModel::Vertex, 3>> triangles{};
+  auto corner = [&](int x, int y) {
+    return LveModel::Vertex{
+        {2.0f * x / grid_size - 1.0f, 2.0f * y / grid_size - 1.0f}, {1.0f, 1.0f, 1.0f}};
+  };
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      triangles.push_back({corner(x, y), corner(x + 1, y), corner(x, y + 1)});
+      triangles.push_back({corner(x + 1, y), corner(x + 1, y + 1), corner(x, y + 1)});
+    }
+  }
+  // Fixed seed, the report is the same every run.
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937{1});
+  std::vector<LveModel::Vertex> triangle_list{};
+  for (const auto &triangle : triangles) {
+    triangle_list.insert(triangle_list.end(), triangle.begin(), triangle.end());
+  }
+  LveModel::Builder builder{};
+  builder.addTriangleList(triangle_list);
+  MeshOptimizationReport report = builder.optimize();
+  std::cout << "Mesh optimizer, " << grid_size << "x" << grid_size << " grid: " << report.triangleCount
+            << " triangles, " << triangle_list.size() << " -> " << report.vertexCount
+            << " vertices, ACMR " << report.acmrBefore << " -> " << report.acmrAfter << "\n";
+}
+
+}  // namespace
+
+HeadlessApp::HeadlessApp(int frame_count, std::string output_path)
+    : frame_count_{frame_count}, output_path_{std::move(output_path)} {}
+
+HeadlessApp::~HeadlessApp() {}
+
+void HeadlessApp::init() {
+  loadGameObjects();
+}
+
+void HeadlessApp::run() {
+  SimpleRendererSystem simple_render_system{
+      lve_device_, lve_renderer_.getRenderPass(), lve_renderer_.getRenderPassCompatibility(), kVertexFormat_};
+  // Ring of triangles written on the compute queue each frame and drawn by the same frame.
+  SimpleComputeSystem simple_compute_system{lve_device_, lve_renderer_.getFramesInFlight(), kVertexFormat_};
+  // Not in the scene, its models belong to simple_compute_system and must not outlive it.
+  std::vector<LveGameObject> compute_objects{};
+  compute_objects.push_back(LveGameObject::createGameObject());
+  // Colored and placed by the compute shader.
+  compute_objects.back().material_.vertexColors = true;
+  compute_objects.back().material_.applyTransform = false;
+  // Drawn last, nothing tests against its depth.
+  compute_objects.back().material_.pipelineState.depthWriteEnable = VK_FALSE;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < frame_count_; i++) {
+    auto command_buffer = lve_renderer_.beginFrame();
+    int frame_index = lve_renderer_.getFrameIndex();
+    auto compute_command_buffer = lve_renderer_.beginCompute();
+    // Fixed time step, the output image doesn't depend on the frame rate.
+    simple_compute_system.Dispatch(compute_command_buffer, frame_index, i / 60.0f);
+    lve_renderer_.endCompute(compute_command_buffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    compute_objects.back().lve_model_ = simple_compute_system.GetModel(frame_index);
+    lve_renderer_.beginRenderPass(command_buffer);
+    simple_render_system.RenderGameObjects(command_buffer, lve_game_objects_);
+    simple_render_system.RenderGameObjects(command_buffer, compute_objects);
+    lve_renderer_.endRenderPass(command_buffer);
+    lve_renderer_.endFrame();
+  }
+  vkDeviceWaitIdle(lve_device_.device());
+  auto end = std::chrono::high_resolution_clock::now();
+
+  float seconds = std::chrono::duration<float>(end - start).count();
+  std::cout << "Rendered " << frame_count_ << " frames in " << seconds << "s ("
+            << (seconds > 0.0f ? frame_count_ / seconds : 0.0f) << " fps)\n";
+  if (!output_path_.empty() && frame_count_ > 0) {
+    lve_renderer_.writePpm(output_path_);
+    std::cout << "Wrote " << output_path_ << "\n";
+  }
+  // One per shader variant with extended dynamic state, more with LVE_BAKED_PIPELINE_STATE set.
+  std::cout << "Pipelines: " << simple_render_system.PipelineCount() << "\n";
+  ReportMeshOptimization(/*grid_size*/ 64);
+}
+
+// FirstApp's scene, plus an overlay drawn with other pipeline state.
+void HeadlessApp::loadGameObjects() {
+  LveModel::Builder builder{};
+  builder.vertexFormat = kVertexFormat_;
+  builder.addTriangleList({
+    {{0.0, -0.5}, {1.0f, 0.0f, 0.0f}},
+    {{0.5, 0.5}, {0.f, 1.0f, 0.0f}},
+    {{-0.5, 0.5}, {0.0f, 0.0f, 1.0f}}
+  });
+  auto lve_model = std::make_shared<LveModel>(lve_device_, geometry_pool_, builder);
+  LveGameObject triangle = LveGameObject::createGameObject();
+  triangle.lve_model_ = lve_model;
+  triangle.color_ = {0.1f, 0.8f, 0.1f};
+  triangle.transform2d_.translation.x = 0.2f;
+  triangle.transform2d_.scale = {2.0f, 0.5f};
+  triangle.transform2d_.rotation = 0.25f * glm::two_pi<float>();
+  // Wound clockwise on screen(the front face), scale and rotation keep it that way.
+  triangle.material_.pipelineState.cullMode = VK_CULL_MODE_BACK_BIT;
+  lve_game_objects_.push_back(std::move(triangle));
+
+  // Same model and shader variant, its depth would fail against the triangle's(both at z = 0)
+  // with depth testing on.
+  LveGameObject overlay = LveGameObject::createGameObject();
+  overlay.lve_model_ = lve_model;
+  overlay.color_ = {0.9f, 0.9f, 0.9f};
+  overlay.transform2d_.translation.x = 0.2f;
+  overlay.transform2d_.scale = {0.5f, 0.5f};
+  overlay.material_.pipelineState.depthTestEnable = VK_FALSE;
+  lve_game_objects_.push_back(std::move(overlay));
+}
+
+}  // namespace lve
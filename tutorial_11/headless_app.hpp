@@ -0,0 +1,40 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_game_object.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_offscreen_renderer.hpp"
+
+#include <string>
+#include <vector>
+
+namespace lve {
+// FirstApp without a window. Renders its scene(plus an overlay) into offscreen images on a
+// headless device, for CI, benchmarking and golden image tests on machines without a display.
+class HeadlessApp {
+  public:
+    static constexpr int kWidth_ = 800;
+    static constexpr int kHeight_ = 600;
+    // Same as FirstApp::kVertexFormat_.
+    static constexpr VertexFormat kVertexFormat_ = VertexFormat::kSnorm16;
+    // Renders frame_count frames, then writes the last one to output_path if not empty.
+    HeadlessApp(int frame_count, std::string output_path);
+    ~HeadlessApp();
+    HeadlessApp(const HeadlessApp &) = delete;
+    HeadlessApp &operator=(const HeadlessApp &) = delete;
+
+    void init();
+    void run();
+
+  protected:
+    void loadGameObjects();
+
+    int frame_count_;
+    std::string output_path_;
+    LveDevice lve_device_{};
+    LveGeometryPool geometry_pool_{lve_device_, vertexStride(kVertexFormat_)};
+    std::vector<LveGameObject> lve_game_objects_;
+    LveOffscreenRenderer lve_renderer_{lve_device_, {kWidth_, kHeight_}};
+};
+
+}  // namespace lve
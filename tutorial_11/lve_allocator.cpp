@@ -0,0 +1,241 @@
+#include "lve_allocator.hpp"
+
+// std headers
+#include <algorithm>
+#include <stdexcept>
+
+namespace lve {
+
+LveAllocator::LveAllocator(VkPhysicalDevice physical_device, VkDevice device) : device_{device} {
+  vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+  pools_.resize(memory_properties_.memoryTypeCount * 2);
+}
+
+LveAllocator::~LveAllocator() {
+  // Anything still alive here is leaked by the owner, but the blocks themselves must go
+  // before the logical device is destroyed.
+  for (auto &pool : pools_) {
+    for (auto &block : pool.blocks) {
+      if (block != nullptr) {
+        vkFreeMemory(device_, block->memory, nullptr);
+      }
+    }
+  }
+}
+
+uint32_t LveAllocator::maxOrder() { return orderForSize(kBlockSize); }
+
+uint32_t LveAllocator::orderForSize(VkDeviceSize size) {
+  uint32_t order = 0;
+  VkDeviceSize buddy_size = kMinAllocationSize;
+  while (buddy_size < size) {
+    buddy_size <<= 1;
+    order++;
+  }
+  return order;
+}
+
+uint32_t LveAllocator::findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+    if ((type_filter & (1 << i)) &&
+        (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool LveAllocator::hasLargeHostVisibleDeviceLocalMemory() const {
+  const VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  // Same type findMemoryType picks, so the heap checked is the one allocations come from.
+  for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+    if ((memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+      uint32_t heap_index = memory_properties_.memoryTypes[i].heapIndex;
+      return memory_properties_.memoryHeaps[heap_index].size > kBarWindowSize;
+    }
+  }
+  return false;
+}
+
+uint32_t LveAllocator::deviceMemoryCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  uint32_t count = dedicated_count_;
+  for (const auto &pool : pools_) {
+    for (const auto &block : pool.blocks) {
+      if (block != nullptr) count++;
+    }
+  }
+  return count;
+}
+
+VkDeviceMemory LveAllocator::allocateDeviceMemory(
+    VkDeviceSize size, uint32_t memory_type_index, void **mapped) {
+  VkMemoryAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = size;
+  alloc_info.memoryTypeIndex = memory_type_index;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device_, &alloc_info, nullptr, &memory) != VK_SUCCESS) {
+    return VK_NULL_HANDLE;
+  }
+
+  *mapped = nullptr;
+  // Host visible memory is mapped for its whole life time. Mapping is cheap to keep around,
+  // and map/unmap on every write is exactly the per resource driver round trip we want to avoid.
+  if (memory_properties_.memoryTypes[memory_type_index].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+      vkFreeMemory(device_, memory, nullptr);
+      throw std::runtime_error("failed to map device memory!");
+    }
+  }
+  return memory;
+}
+
+uint32_t LveAllocator::createBlock(Pool &pool, uint32_t memory_type_index) {
+  void *mapped = nullptr;
+  VkDeviceMemory memory = allocateDeviceMemory(kBlockSize, memory_type_index, &mapped);
+  if (memory == VK_NULL_HANDLE) {
+    throw std::runtime_error("failed to allocate device memory block!");
+  }
+
+  auto block = std::make_unique<Block>();
+  block->memory = memory;
+  block->mapped = mapped;
+  block->free_lists.resize(maxOrder() + 1);
+  // A fresh block is a single free buddy of the highest order.
+  block->free_lists[maxOrder()].insert(0);
+
+  // Reuse a slot left behind by a released block, so indices held by live allocations stay valid.
+  for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+    if (pool.blocks[i] == nullptr) {
+      pool.blocks[i] = std::move(block);
+      return i;
+    }
+  }
+  pool.blocks.push_back(std::move(block));
+  return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
+
+bool LveAllocator::allocateFromBlock(Block &block, uint32_t order, VkDeviceSize *offset) {
+  // Find the smallest free buddy that fits.
+  uint32_t found = order;
+  while (found < block.free_lists.size() && block.free_lists[found].empty()) {
+    found++;
+  }
+  if (found >= block.free_lists.size()) {
+    return false;
+  }
+
+  VkDeviceSize start = *block.free_lists[found].begin();
+  block.free_lists[found].erase(block.free_lists[found].begin());
+  // Split it in halves until it has the requested size, keeping the lower half and
+  // returning the upper half(the buddy) to the free list one order below.
+  while (found > order) {
+    found--;
+    block.free_lists[found].insert(start + (kMinAllocationSize << found));
+  }
+  block.used_bytes += kMinAllocationSize << order;
+  *offset = start;
+  return true;
+}
+
+void LveAllocator::freeToBlock(Block &block, uint32_t order, VkDeviceSize offset) {
+  block.used_bytes -= kMinAllocationSize << order;
+  // Merge with the buddy for as long as it is free too.
+  while (order < maxOrder()) {
+    VkDeviceSize buddy = offset ^ (kMinAllocationSize << order);
+    auto it = block.free_lists[order].find(buddy);
+    if (it == block.free_lists[order].end()) {
+      break;
+    }
+    block.free_lists[order].erase(it);
+    offset = std::min(offset, buddy);
+    order++;
+  }
+  block.free_lists[order].insert(offset);
+}
+
+LveAllocation LveAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties,
+    ResourceKind kind) {
+  LveAllocation allocation{};
+  allocation.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+  allocation.size = requirements.size;
+
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  // Big resources(e.g full screen images) would waste most of a buddy, give them their own memory.
+  if (requirements.size > kDedicatedThreshold) {
+    allocation.memory =
+        allocateDeviceMemory(requirements.size, allocation.memoryTypeIndex, &allocation.mapped);
+    if (allocation.memory == VK_NULL_HANDLE) {
+      throw std::runtime_error("failed to allocate dedicated device memory!");
+    }
+    allocation.dedicated = true;
+    dedicated_count_++;
+    return allocation;
+  }
+
+  VkDeviceSize required = std::max(requirements.size, requirements.alignment);
+  allocation.order = orderForSize(required);
+  allocation.poolIndex = allocation.memoryTypeIndex * 2 + static_cast<uint32_t>(kind);
+  Pool &pool = pools_[allocation.poolIndex];
+
+  VkDeviceSize offset = 0;
+  bool found = false;
+  for (uint32_t i = 0; i < pool.blocks.size() && !found; i++) {
+    if (pool.blocks[i] != nullptr && allocateFromBlock(*pool.blocks[i], allocation.order, &offset)) {
+      allocation.blockIndex = i;
+      found = true;
+    }
+  }
+  if (!found) {
+    allocation.blockIndex = createBlock(pool, allocation.memoryTypeIndex);
+    allocateFromBlock(*pool.blocks[allocation.blockIndex], allocation.order, &offset);
+  }
+
+  Block &block = *pool.blocks[allocation.blockIndex];
+  allocation.memory = block.memory;
+  allocation.offset = offset;
+  if (block.mapped != nullptr) {
+    allocation.mapped = static_cast<char *>(block.mapped) + offset;
+  }
+  return allocation;
+}
+
+void LveAllocator::free(LveAllocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  if (allocation.dedicated) {
+    vkFreeMemory(device_, allocation.memory, nullptr);
+    dedicated_count_--;
+  } else {
+    Pool &pool = pools_[allocation.poolIndex];
+    Block &block = *pool.blocks[allocation.blockIndex];
+    freeToBlock(block, allocation.order, allocation.offset);
+
+    // Keep one empty block around per pool to avoid thrashing when a resource is recreated,
+    // but give any other empty block back to the driver.
+    if (block.used_bytes == 0) {
+      auto live_blocks = std::count_if(
+          pool.blocks.begin(),
+          pool.blocks.end(),
+          [](const std::unique_ptr<Block> &b) { return b != nullptr; });
+      if (live_blocks > 1) {
+        vkFreeMemory(device_, block.memory, nullptr);
+        pool.blocks[allocation.blockIndex].reset();
+      }
+    }
+  }
+  allocation = LveAllocation{};
+}
+
+}  // namespace lve
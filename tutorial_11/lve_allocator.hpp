@@ -0,0 +1,105 @@
+#pragma once
+
+// Keep beta extensions (portability subset) visible no matter which header pulls in vulkan first.
+#define VK_ENABLE_BETA_EXTENSIONS
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace lve {
+
+// A range inside a VkDeviceMemory block handed out by LveAllocator.
+// Resources bind to memory at `offset`, never at 0, since many resources share one block.
+struct LveAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  // Points at `offset` inside the block when the memory type is host visible, otherwise nullptr.
+  // Blocks are mapped once and stay mapped, because a VkDeviceMemory can only be mapped once at a
+  // time and it is shared by many allocations.
+  void *mapped = nullptr;
+
+  // Book keeping used by the allocator to give the range back.
+  uint32_t memoryTypeIndex = 0;
+  uint32_t poolIndex = 0;
+  uint32_t blockIndex = 0;
+  uint32_t order = 0;
+  bool dedicated = false;
+};
+
+// Sub-allocating GPU memory allocator.
+// Problem: There exist hard limit to number of active allocation(~1000, maxMemoryAllocationCount)
+// and every vkAllocateMemory is a driver round trip.
+// Solution: Allocate big blocks per memory type and hand out aligned sub-ranges from them using a
+// buddy allocator. Every range is a power of two in size and aligned to its own size, so any
+// Vulkan alignment requirement(always a power of two) is met by rounding the size up.
+class LveAllocator {
+ public:
+  // Size of a VkDeviceMemory block. Resources larger than half a block get a dedicated allocation.
+  static constexpr VkDeviceSize kBlockSize = 64ull * 1024 * 1024;
+  // Smallest range handed out, i.e the size of an order 0 buddy.
+  static constexpr VkDeviceSize kMinAllocationSize = 256;
+  static constexpr VkDeviceSize kDedicatedThreshold = kBlockSize / 2;
+  // Size of the host visible VRAM window without resizable BAR.
+  static constexpr VkDeviceSize kBarWindowSize = 256ull * 1024 * 1024;
+
+  // Buffers and linear images(kLinear) live in different blocks than optimal tiled images(kOptimal)
+  // so neighbours never violate bufferImageGranularity.
+  enum class ResourceKind { kLinear = 0, kOptimal = 1 };
+
+  LveAllocator(VkPhysicalDevice physical_device, VkDevice device);
+  ~LveAllocator();
+
+  LveAllocator(const LveAllocator &) = delete;
+  LveAllocator &operator=(const LveAllocator &) = delete;
+
+  LveAllocation allocate(
+      const VkMemoryRequirements &requirements,
+      VkMemoryPropertyFlags properties,
+      ResourceKind kind);
+  void free(LveAllocation &allocation);
+
+  uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+  // True when DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT memory covers more than the classic
+  // 256MB BAR window: resizable BAR on discrete GPUs, or the shared memory of integrated ones.
+  // Resources there are written by the CPU directly and read by the GPU at full speed.
+  bool hasLargeHostVisibleDeviceLocalMemory() const;
+  const VkPhysicalDeviceMemoryProperties &memoryProperties() const { return memory_properties_; }
+
+  // Number of live vkAllocateMemory calls, useful to check we stay far below the driver limit.
+  uint32_t deviceMemoryCount() const;
+
+ private:
+  struct Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped = nullptr;
+    // free_lists[order] holds offsets of free buddies of size (kMinAllocationSize << order).
+    std::vector<std::set<VkDeviceSize>> free_lists;
+    VkDeviceSize used_bytes = 0;
+  };
+  // One pool per (memory type, resource kind).
+  struct Pool {
+    std::vector<std::unique_ptr<Block>> blocks;
+  };
+
+  static uint32_t orderForSize(VkDeviceSize size);
+  static uint32_t maxOrder();
+
+  VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memory_type_index, void **mapped);
+  bool allocateFromBlock(Block &block, uint32_t order, VkDeviceSize *offset);
+  void freeToBlock(Block &block, uint32_t order, VkDeviceSize offset);
+  uint32_t createBlock(Pool &pool, uint32_t memory_type_index);
+
+  VkDevice device_;
+  VkPhysicalDeviceMemoryProperties memory_properties_;
+  std::vector<Pool> pools_;
+  uint32_t dedicated_count_ = 0;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace lve
@@ -0,0 +1,76 @@
+#include "lve_compute_pipeline.hpp"
+
+#include <stdexcept>
+
+namespace lve {
+    LveComputePipeline::LveComputePipeline(LveDevice &device,
+                                           const std::string& comp_file_path,
+                                           VkPipelineLayout pipeline_layout,
+                                           const SpecializationConstants& specialization) : lve_device_{device} {
+        CreateComputePipeline(comp_file_path, pipeline_layout, specialization);
+    }
+
+    LveComputePipeline::~LveComputePipeline() {
+        vkDestroyPipeline(lve_device_.device(), compute_pipeline_, nullptr);
+    }
+
+    void LveComputePipeline::CreateComputePipeline(const std::string& comp_file_path,
+                                                   VkPipelineLayout pipeline_layout,
+                                                   const SpecializationConstants& specialization) {
+        // Same shader library as the graphics pipeline.
+        comp_shader_module_ = lve_device_.shaderLibrary().load(comp_file_path);
+
+        VkPipelineShaderStageCreateInfo shader_stage{};
+        shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shader_stage.module = comp_shader_module_->module();
+        // pName the name to the entry function in shader.
+        shader_stage.pName = "main";
+        shader_stage.flags = 0;
+        shader_stage.pNext = nullptr;
+        VkSpecializationInfo specialization_info{};
+        specialization_info.mapEntryCount = static_cast<uint32_t>(specialization.mapEntries.size());
+        specialization_info.pMapEntries = specialization.mapEntries.data();
+        specialization_info.dataSize = specialization.data.size();
+        specialization_info.pData = specialization.data.data();
+        shader_stage.pSpecializationInfo = specialization.empty() ? nullptr : &specialization_info;
+
+        VkComputePipelineCreateInfo pipeline_info{};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage = shader_stage;
+        pipeline_info.layout = pipeline_layout;
+        pipeline_info.basePipelineIndex = -1;
+        pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+        VkPipelineCreationFeedbackEXT pipeline_feedback{};
+        VkPipelineCreationFeedbackEXT stage_feedback{};
+        VkPipelineCreationFeedbackCreateInfoEXT feedback_info{};
+        feedback_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedback_info.pPipelineCreationFeedback = &pipeline_feedback;
+        feedback_info.pipelineStageCreationFeedbackCount = 1;
+        feedback_info.pPipelineStageCreationFeedbacks = &stage_feedback;
+        if (lve_device_.hasPipelineCreationFeedback()) {
+            pipeline_info.pNext = &feedback_info;
+        }
+
+        if(vkCreateComputePipelines(lve_device_.device(), lve_device_.pipelineCache(), /*pipeline count*/ 1,
+                                    &pipeline_info, /*alloc callback*/ nullptr, &compute_pipeline_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute pipeline.");
+        }
+        if (lve_device_.hasPipelineCreationFeedback()) {
+            lve_device_.reportPipelineFeedback(pipeline_feedback);
+        }
+    }
+
+    void LveComputePipeline::bind(VkCommandBuffer command_buffer) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+    }
+
+    void LveComputePipeline::dispatch(VkCommandBuffer command_buffer,
+                                      uint32_t group_count_x,
+                                      uint32_t group_count_y,
+                                      uint32_t group_count_z) {
+        vkCmdDispatch(command_buffer, group_count_x, group_count_y, group_count_z);
+    }
+
+} // namespace lve
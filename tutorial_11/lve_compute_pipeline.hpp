@@ -0,0 +1,44 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_shader_library.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Compute counterpart of LvePipeline. A compute pipeline only has one programmable stage,
+// so there is no config info to fill, only the shader, the pipeline layout(descriptor sets +
+// push constants) it is used with and its specialization constants.
+class LveComputePipeline {
+    public:
+    LveComputePipeline(LveDevice &device,
+                       const std::string& comp_file_path,
+                       VkPipelineLayout pipeline_layout,
+                       const SpecializationConstants& specialization = {});
+    ~LveComputePipeline();
+    // RAII style to prevent memory faults.
+    LveComputePipeline(const LveComputePipeline&) = delete;
+    LveComputePipeline& operator=(const LveComputePipeline&) = delete;
+
+    // Binds compute pipeline into the command buffer.
+    void bind(VkCommandBuffer command_buffer);
+    // Launch group_count_x * group_count_y * group_count_z workgroups, the size of a workgroup
+    // is set in the shader with layout(local_size_x = ...).
+    void dispatch(VkCommandBuffer command_buffer,
+                  uint32_t group_count_x,
+                  uint32_t group_count_y = 1,
+                  uint32_t group_count_z = 1);
+
+    private:
+    void CreateComputePipeline(const std::string& comp_file_path,
+                               VkPipelineLayout pipeline_layout,
+                               const SpecializationConstants& specialization);
+
+    LveDevice& lve_device_;
+    VkPipeline compute_pipeline_;
+    std::shared_ptr<LveShaderModule> comp_shader_module_;
+};
+} // namespace lve
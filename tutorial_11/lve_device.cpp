@@ -1,7 +1,17 @@
 #include "lve_device.hpp"
+#include "lve_dynamic_state.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_shader_library.hpp"
+#include "lve_upload_context.hpp"
 
 // std headers
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -47,21 +57,49 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-LveDevice::LveDevice(LveWindow &window) : window{window} {
+LveDevice::LveDevice(LveWindow &window) : window{&window} { init(); }
+
+LveDevice::LveDevice() : window{nullptr} { init(); }
+
+void LveDevice::init() {
+  if (!isHeadless()) {
+    deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
   // Creates vulkan instance to connect our app to Vulkan lib.
   createInstance();
   // Setup validation layers. Vulkan does not have error checking, so we need to set our own here.
   setupDebugMessenger();
-  // Relies on glfw, connect window and vulkan displaying of result.
-  createSurface();
+  // Relies on glfw, connect window and vulkan displaying of result. Nothing to display headless.
+  if (!isHeadless()) {
+    createSurface();
+  }
   // Picking graphic device/GPU in system. Can be multiple device.
   pickPhysicalDevice();
   // Set what features of the physical device we want to use.
   createLogicalDevice();
   createCommandPool();
+  // Sub-allocates buffers and images out of big memory blocks.
+  createAllocator();
+  createUploadContext();
+  createPipelineCache();
+  createShaderLibrary();
+  createPipelineRegistry();
+  createDynamicState();
 }
 
 LveDevice::~LveDevice() {
+  // Written back at shutdown, so everything compiled during the run is in the next startup's cache.
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+  // Modules and pipelines are owned by their users, which are all gone by now.
+  pipelineRegistry_.reset();
+  shaderLibrary_.reset();
+  dynamicState_.reset();
+  // Waits for pending uploads, and gives its staging memory back to the allocator.
+  uploadContext_.reset();
+  // Memory blocks have to be freed while the logical device is still alive.
+  allocator_.reset();
+  vkDestroyCommandPool(device_, computeCommandPool, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -69,7 +107,9 @@ LveDevice::~LveDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -106,7 +146,12 @@ void LveDevice::createInstance() {
     createInfo.pNext = nullptr;
   }
   // For APPLE devices.
-  createInfo.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+  createInfo.flags = 0;
+  for (const char *extension : extensions) {
+    if (strcmp(extension, VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME) == 0) {
+      createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+    }
+  }
   if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
     throw std::runtime_error("failed to create instance!");
   }
@@ -124,11 +169,60 @@ void LveDevice::pickPhysicalDevice() {
   std::vector<VkPhysicalDevice> devices(deviceCount);
   vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-  for (const auto &device : devices) {
-    if (isDeviceSuitable(device)) {
-      physicalDevice = device;
+  // Forced device, e.g LVE_DEVICE_INDEX=1 or LVE_DEVICE_NAME="RTX" (case sensitive substring).
+  const char *forcedIndex = std::getenv("LVE_DEVICE_INDEX");
+  const char *forcedName = std::getenv("LVE_DEVICE_NAME");
+  if (forcedIndex != nullptr || forcedName != nullptr) {
+    unsigned long index = 0;
+    if (forcedIndex != nullptr) {
+      char *end = nullptr;
+      errno = 0;
+      index = std::strtoul(forcedIndex, &end, 10);
+      // strtoul alone takes "", "gpu" as 0 and "-1" as ULONG_MAX.
+      if (!std::isdigit(static_cast<unsigned char>(forcedIndex[0])) || *end != '\0' || errno == ERANGE) {
+        throw std::runtime_error(std::string("LVE_DEVICE_INDEX is not a device index: ") + forcedIndex);
+      }
+    }
+    // A name can match several devices, the first suitable one wins.
+    std::string unsuitableMatches;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+      VkPhysicalDeviceProperties deviceProperties;
+      vkGetPhysicalDeviceProperties(devices[i], &deviceProperties);
+      bool matches = forcedIndex != nullptr ? index == i
+                                            : strstr(deviceProperties.deviceName, forcedName) != nullptr;
+      if (!matches) {
+        continue;
+      }
+      if (!isDeviceSuitable(devices[i])) {
+        unsuitableMatches += std::string(unsuitableMatches.empty() ? "" : ", ") + deviceProperties.deviceName;
+        continue;
+      }
+      physicalDevice = devices[i];
       break;
     }
+    if (physicalDevice == VK_NULL_HANDLE && !unsuitableMatches.empty()) {
+      throw std::runtime_error("forced GPU is not suitable: " + unsuitableMatches);
+    }
+    if (physicalDevice == VK_NULL_HANDLE) {
+      throw std::runtime_error("failed to find the GPU set by LVE_DEVICE_INDEX/LVE_DEVICE_NAME!");
+    }
+  } else {
+    // Enumeration order is up to the loader, the first suitable device is often an integrated
+    // GPU or a software rasterizer. Take the best scoring one instead.
+    uint64_t bestScore = 0;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+      if (!isDeviceSuitable(devices[i])) {
+        continue;
+      }
+      uint64_t score = rateDeviceSuitability(devices[i]);
+      VkPhysicalDeviceProperties deviceProperties;
+      vkGetPhysicalDeviceProperties(devices[i], &deviceProperties);
+      std::cout << "\t[" << i << "] " << deviceProperties.deviceName << " score: " << score << std::endl;
+      if (physicalDevice == VK_NULL_HANDLE || score > bestScore) {
+        physicalDevice = devices[i];
+        bestScore = score;
+      }
+    }
   }
 
   if (physicalDevice == VK_NULL_HANDLE) {
@@ -143,7 +237,8 @@ void LveDevice::createLogicalDevice() {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  std::set<uint32_t> uniqueQueueFamilies = {
+      indices.graphicsFamily, indices.presentFamily, indices.transferFamily, indices.computeFamily};
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -165,8 +260,54 @@ void LveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  // Portability subset must be enabled whenever the device exposes it(APPLE devices),
+  // but it doesn't exist anywhere else.
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  if (isDeviceExtensionAvailable(physicalDevice, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME)) {
+    enabledExtensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
+  }
+  // Optional, only used to report pipeline cache hits/misses.
+  if (isDeviceExtensionAvailable(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)) {
+    enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    pipelineCreationFeedbackEnabled_ = true;
+  }
+  // Optional, lets pipelines set more state per draw instead of baking it, see LveDynamicState.
+  // The feature structs chain into createInfo directly, which works with a 1.0 instance.
+  queryExtendedDynamicStateSupport();
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+  extendedDynamicStateFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+  VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+  extendedDynamicState2Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+  VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+  extendedDynamicState3Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+  // Built back to front, each struct points at the ones enabled after it.
+  void *enabledFeatures = nullptr;
+  if (extendedDynamicStateSupport_.state3) {
+    enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+    extendedDynamicState3Features.extendedDynamicState3ColorBlendEquation = VK_TRUE;
+    extendedDynamicState3Features.extendedDynamicState3ColorWriteMask = VK_TRUE;
+    extendedDynamicState3Features.pNext = enabledFeatures;
+    enabledFeatures = &extendedDynamicState3Features;
+  }
+  if (extendedDynamicStateSupport_.state2) {
+    enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+    extendedDynamicState2Features.extendedDynamicState2 = VK_TRUE;
+    extendedDynamicState2Features.pNext = enabledFeatures;
+    enabledFeatures = &extendedDynamicState2Features;
+  }
+  if (extendedDynamicStateSupport_.state1) {
+    enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+    extendedDynamicStateFeatures.pNext = enabledFeatures;
+    enabledFeatures = &extendedDynamicStateFeatures;
+  }
+  createInfo.pNext = enabledFeatures;
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -183,6 +324,8 @@ void LveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+  vkGetDeviceQueue(device_, indices.computeFamily, 0, &computeQueue_);
 }
 
 void LveDevice::createCommandPool() {
@@ -197,17 +340,201 @@ void LveDevice::createCommandPool() {
   if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
+
+  poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
+  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute command pool!");
+  }
+}
+
+void LveDevice::createAllocator() {
+  allocator_ = std::make_unique<LveAllocator>(physicalDevice, device_);
+}
+
+void LveDevice::createUploadContext() {
+  uploadContext_ = std::make_unique<LveUploadContext>(*this);
+}
+
+// One file per vendor/device/driver build(pipelineCacheUUID changes with the driver), so caches of
+// different GPUs or drivers never get mixed up.
+std::string LveDevice::pipelineCachePath() {
+  char name[128];
+  int length = snprintf(
+      name, sizeof(name), "pipeline_cache_%04x_%04x_", properties.vendorID, properties.deviceID);
+  std::string path(name, length);
+  for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+    snprintf(name, sizeof(name), "%02x", properties.pipelineCacheUUID[i]);
+    path += name;
+  }
+  return path + ".bin";
+}
+
+// Drivers are supposed to reject foreign data themselves, but not all of them do. Check the
+// header(VkPipelineCacheHeaderVersionOne) before handing the data over.
+bool LveDevice::isPipelineCacheDataValid(const std::vector<char> &data) {
+  // headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID.
+  constexpr size_t kHeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (data.size() < kHeaderSize) {
+    return false;
+  }
+  uint32_t header[4];
+  memcpy(header, data.data(), sizeof(header));
+  return header[0] >= kHeaderSize && header[0] <= data.size() &&
+         header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header[2] == properties.vendorID && header[3] == properties.deviceID &&
+         memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void LveDevice::createPipelineCache() {
+  std::vector<char> data;
+  std::ifstream file{pipelineCachePath(), std::ios::ate | std::ios::binary};
+  if (file.is_open()) {
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    if (!isPipelineCacheDataValid(data)) {
+      std::cout << "Ignoring stale pipeline cache " << pipelineCachePath() << std::endl;
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+}
+
+void LveDevice::savePipelineCache() {
+  if (pipelineCache_ == VK_NULL_HANDLE) {
+    return;
+  }
+  size_t size = 0;
+  vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr);
+  std::vector<char> data(size);
+  if (size == 0 || vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  // Written to a temporary file and renamed over the old one. rename is atomic, so a crash or a
+  // second instance never leaves a half written cache behind.
+  std::string path = pipelineCachePath();
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      std::cerr << "failed to write pipeline cache " << tmpPath << std::endl;
+      return;
+    }
+    file.write(data.data(), size);
+    if (!file.good()) {
+      std::cerr << "failed to write pipeline cache " << tmpPath << std::endl;
+      return;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::cerr << "failed to replace pipeline cache " << path << std::endl;
+    std::remove(tmpPath.c_str());
+    return;
+  }
+  std::cout << "Pipeline cache: " << pipelineCacheHits_ << " hits, " << pipelineCacheMisses_
+            << " misses, saved " << size << " bytes" << std::endl;
+}
+
+void LveDevice::reportPipelineFeedback(const VkPipelineCreationFeedbackEXT &feedback) {
+  if (!(feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+    return;
+  }
+  if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+    pipelineCacheHits_++;
+  } else {
+    pipelineCacheMisses_++;
+  }
+}
+
+void LveDevice::createShaderLibrary() {
+  shaderLibrary_ = std::make_unique<LveShaderLibrary>(device_);
+}
+
+void LveDevice::createPipelineRegistry() {
+  pipelineRegistry_ = std::make_unique<LvePipelineRegistry>(*this);
+}
+
+void LveDevice::createDynamicState() {
+  dynamicState_ = std::make_unique<LveDynamicState>(device_, extendedDynamicStateSupport_);
+}
+
+void LveDevice::queryExtendedDynamicStateSupport() {
+  extendedDynamicStateSupport_ = {};
+  // Set LVE_BAKED_PIPELINE_STATE to test the fallback on devices that have the extensions.
+  if (std::getenv("LVE_BAKED_PIPELINE_STATE") != nullptr ||
+      !isDeviceExtensionAvailable(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)) {
+    return;
+  }
+  // Core in 1.1, but the instance is 1.0 with VK_KHR_get_physical_device_properties2.
+  auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(
+      instance, "vkGetPhysicalDeviceFeatures2KHR");
+  if (getFeatures2 == nullptr) {
+    return;
+  }
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT state1Features{};
+  state1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+  VkPhysicalDeviceExtendedDynamicState2FeaturesEXT state2Features{};
+  state2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+  VkPhysicalDeviceExtendedDynamicState3FeaturesEXT state3Features{};
+  state3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+  // Only chain the structs of extensions the device has.
+  bool hasState2 =
+      isDeviceExtensionAvailable(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+  bool hasState3 =
+      isDeviceExtensionAvailable(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+  if (hasState3) {
+    state2Features.pNext = &state3Features;
+    state1Features.pNext = &state3Features;
+  }
+  if (hasState2) {
+    state1Features.pNext = &state2Features;
+  }
+  VkPhysicalDeviceFeatures2KHR features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+  features.pNext = &state1Features;
+  getFeatures2(physicalDevice, &features);
+
+  extendedDynamicStateSupport_.state1 = state1Features.extendedDynamicState;
+  extendedDynamicStateSupport_.state2 =
+      extendedDynamicStateSupport_.state1 && hasState2 && state2Features.extendedDynamicState2;
+  extendedDynamicStateSupport_.state3 = extendedDynamicStateSupport_.state1 && hasState3 &&
+                                        state3Features.extendedDynamicState3ColorBlendEnable &&
+                                        state3Features.extendedDynamicState3ColorBlendEquation &&
+                                        state3Features.extendedDynamicState3ColorWriteMask;
+  // state2/state3 are only set along with state1.
+  std::cout << "extended dynamic state:";
+  if (extendedDynamicStateSupport_.state1) {
+    std::cout << " " << VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME;
+  } else {
+    std::cout << " none";
+  }
+  if (extendedDynamicStateSupport_.state2) {
+    std::cout << " " << VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME;
+  }
+  if (extendedDynamicStateSupport_.state3) {
+    std::cout << " " << VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME;
+  }
+  std::cout << std::endl;
 }
 
-void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void LveDevice::createSurface() { window->createWindowSurface(instance, &surface_); }
 
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // Headless devices never create a swap chain.
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -219,6 +546,63 @@ bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
          supportedFeatures.samplerAnisotropy;
 }
 
+// Only called for suitable devices. Weights are picked so that a criteria only breaks ties of the
+// ones above it: device type > VRAM > queue layout > optional features.
+uint64_t LveDevice::rateDeviceSuitability(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  uint64_t score = 0;
+  switch (deviceProperties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      score += 4'000'000;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      score += 3'000'000;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      score += 2'000'000;
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      score += 1'000'000;
+      break;
+    default:
+      break;
+  }
+
+  // Largest device local heap, in 256MB steps and capped at 64GB so it stays below the type weight.
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+  VkDeviceSize deviceLocalSize = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      deviceLocalSize = std::max(deviceLocalSize, memoryProperties.memoryHeaps[i].size);
+    }
+  }
+  score += std::min<VkDeviceSize>(deviceLocalSize / (256ull << 20), 256) * 1000;
+
+  // Copy engine for uploads and a compute-only family for async compute.
+  QueueFamilyIndices indices = findQueueFamilies(device);
+  if (indices.hasDedicatedTransfer()) {
+    score += 200;
+  }
+  if (indices.hasAsyncCompute()) {
+    score += 200;
+  }
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+  if (supportedFeatures.multiDrawIndirect) {
+    score += 10;
+  }
+  if (supportedFeatures.fillModeNonSolid) {
+    score += 10;
+  }
+  if (supportedFeatures.wideLines) {
+    score += 10;
+  }
+  return score;
+}
+
 void LveDevice::populateDebugMessengerCreateInfo(
     VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
   createInfo = {};
@@ -267,17 +651,22 @@ bool LveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  // Surface extensions, only needed to display into a window.
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
   }
-  // for APPLE devices.
-  extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+  // for APPLE devices. Optional, so loaders/drivers without it(e.g lavapipe) still work.
+  if (isInstanceExtensionAvailable(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME)) {
+    extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+  }
   extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
   return extensions;
@@ -326,6 +715,32 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool LveDevice::isInstanceExtensionAvailable(const char *extensionName) {
+  uint32_t extensionCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+  for (const auto &extension : extensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LveDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+  for (const auto &extension : extensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -337,23 +752,61 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
 
   int i = 0;
   for (const auto &queueFamily : queueFamilies) {
-    if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+    if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT &&
+        !indices.graphicsFamilyHasValue) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-    if (queueFamily.queueCount > 0 && presentSupport) {
+    if (surface_ != VK_NULL_HANDLE) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
+    if (queueFamily.queueCount > 0 && presentSupport && !indices.presentFamilyHasValue) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
     }
-    if (indices.isComplete()) {
-      break;
+    // Transfer-only family = copy engine that runs next to the graphics queue.
+    // Graphics and compute families support transfers too, so look for one that does nothing else.
+    bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                        !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+    if (queueFamily.queueCount > 0 && transferOnly && !indices.transferFamilyHasValue) {
+      indices.transferFamily = i;
+      indices.transferFamilyHasValue = true;
+    }
+    // Compute without graphics = async compute queue.
+    bool computeOnly = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+                       !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+    if (queueFamily.queueCount > 0 && computeOnly && !indices.computeFamilyHasValue) {
+      indices.computeFamily = i;
+      indices.computeFamilyHasValue = true;
     }
 
     i++;
   }
 
+  // Nothing is presented when headless, the present queue is just the graphics queue.
+  if (isHeadless() && indices.graphicsFamilyHasValue) {
+    indices.presentFamily = indices.graphicsFamily;
+    indices.presentFamilyHasValue = true;
+  }
+  // No copy engine, uploads share the graphics queue.
+  if (!indices.transferFamilyHasValue && indices.graphicsFamilyHasValue) {
+    indices.transferFamily = indices.graphicsFamily;
+    indices.transferFamilyHasValue = true;
+  }
+  // No async compute, prefer sharing the graphics queue so no ownership transfers are needed.
+  if (!indices.computeFamilyHasValue && indices.graphicsFamilyHasValue &&
+      queueFamilies[indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+    indices.computeFamily = indices.graphicsFamily;
+    indices.computeFamilyHasValue = true;
+  }
+  for (uint32_t j = 0; j < queueFamilyCount && !indices.computeFamilyHasValue; j++) {
+    if (queueFamilies[j].queueCount > 0 && queueFamilies[j].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+      indices.computeFamily = j;
+      indices.computeFamilyHasValue = true;
+    }
+  }
+
   return indices;
 }
 
@@ -400,16 +853,7 @@ VkFormat LveDevice::findSupportedFormat(
 }
 
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if ((typeFilter & (1 << i)) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-      return i;
-    }
-  }
-
-  throw std::runtime_error("failed to find suitable memory type!");
+  return allocator_->findMemoryType(typeFilter, properties);
 }
 
 void LveDevice::createBuffer(
@@ -417,30 +861,46 @@ void LveDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    LveAllocation &bufferAllocation,
+    bool sharedWithCompute) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  QueueFamilyIndices indices{};
+  uint32_t queueFamilyIndices[2];
+  if (sharedWithCompute) {
+    indices = findPhysicalQueueFamilies();
+  }
+  if (indices.hasAsyncCompute()) {
+    queueFamilyIndices[0] = indices.graphicsFamily;
+    queueFamilyIndices[1] = indices.computeFamily;
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = 2;
+    bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+  }
 
   if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create vertex buffer!");
+    throw std::runtime_error("failed to create buffer!");
   }
 
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferAllocation =
+      allocator_->allocate(memRequirements, properties, LveAllocator::ResourceKind::kLinear);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to bind buffer memory!");
   }
+}
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+void LveDevice::destroyBuffer(VkBuffer &buffer, LveAllocation &bufferAllocation) {
+  vkDestroyBuffer(device_, buffer, nullptr);
+  allocator_->free(bufferAllocation);
+  buffer = VK_NULL_HANDLE;
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -475,50 +935,20 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
-void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-  VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;  // Optional
-  copyRegion.dstOffset = 0;  // Optional
-  copyRegion.size = size;
-  vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-  endSingleTimeCommands(commandBuffer);
+UploadTicket LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+  return uploadContext_->copyBuffer(srcBuffer, dstBuffer, size);
 }
 
-void LveDevice::copyBufferToImage(
+UploadTicket LveDevice::copyBufferToImage(
     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = layerCount;
-
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {width, height, 1};
-
-  vkCmdCopyBufferToImage(
-      commandBuffer,
-      buffer,
-      image,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      1,
-      &region);
-  endSingleTimeCommands(commandBuffer);
+  return uploadContext_->copyBufferToImage(buffer, image, width, height, layerCount);
 }
 
 void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    LveAllocation &imageAllocation) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -526,18 +956,20 @@ void LveDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  auto kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? LveAllocator::ResourceKind::kLinear
+                                                          : LveAllocator::ResourceKind::kOptimal;
+  imageAllocation = allocator_->allocate(memRequirements, properties, kind);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
-
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void LveDevice::destroyImage(VkImage &image, LveAllocation &imageAllocation) {
+  vkDestroyImage(device_, image, nullptr);
+  allocator_->free(imageAllocation);
+  image = VK_NULL_HANDLE;
+}
+
 }  // namespace lve
\ No newline at end of file
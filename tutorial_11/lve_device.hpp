@@ -1,13 +1,24 @@
 #pragma once
 
+#include "lve_allocator.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+class LveUploadContext;
+class LveShaderLibrary;
+class LvePipelineRegistry;
+class LveDynamicState;
+
+// Identifies a batch of transfers submitted by LveUploadContext.
+using UploadTicket = uint64_t;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,9 +28,32 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  // Family used for uploads. A transfer-only family when the device has one(DMA engine on
+  // discrete GPUs), the graphics family otherwise.
+  uint32_t transferFamily;
+  // Family used for compute work. A compute family without graphics when the device has one
+  // (async compute, runs next to rasterisation), the graphics family otherwise.
+  uint32_t computeFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
+  bool computeFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+  bool hasDedicatedTransfer() const {
+    return transferFamilyHasValue && graphicsFamilyHasValue && transferFamily != graphicsFamily;
+  }
+  bool hasAsyncCompute() const {
+    return computeFamilyHasValue && graphicsFamilyHasValue && computeFamily != graphicsFamily;
+  }
+};
+
+// Which VK_EXT_extended_dynamic_state extensions are enabled, see LveDynamicState.
+// state2/state3 are only enabled together with state1.
+struct ExtendedDynamicStateSupport {
+  bool state1 = false;
+  bool state2 = false;
+  // Only the color blend enable/equation/write mask features of it.
+  bool state3 = false;
 };
 
 class LveDevice {
@@ -30,7 +64,12 @@ class LveDevice {
   const bool enableValidationLayers = true;
 #endif
 
+  // The GPU is picked by score(discrete > integrated > software, then VRAM and queue layout).
+  // Set LVE_DEVICE_INDEX or LVE_DEVICE_NAME in the environment to force a specific one.
   LveDevice(LveWindow &window);
+  // Headless device: no window, no VkSurfaceKHR and no swap chain extension, so it runs on
+  // display-less machines(e.g software ICDs like lavapipe in CI). Render with LveOffscreenRenderer.
+  LveDevice();
   ~LveDevice();
 
   // Not copyable or movable
@@ -40,69 +79,138 @@ class LveDevice {
   LveDevice &operator=(LveDevice &&) = delete;
 
   VkCommandPool getCommandPool() { return commandPool; }
+  // Pool of the compute family, command buffers submitted to computeQueue() come from here.
+  VkCommandPool getComputeCommandPool() { return computeCommandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() const { return window == nullptr; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // Same queue as graphicsQueue() when the device has no dedicated transfer family.
+  VkQueue transferQueue() { return transferQueue_; }
+  // Same queue as graphicsQueue() when the device has no separate compute family.
+  VkQueue computeQueue() { return computeQueue_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
+  // Forwards to allocator().findMemoryType.
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
+  // Device-wide cache passed to every vkCreate*Pipelines. Loaded from / saved to
+  // pipelineCachePath(), so pipelines compiled in a previous run are hits on the next one.
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  // VK_EXT_pipeline_creation_feedback is enabled, pipelines chain a
+  // VkPipelineCreationFeedbackCreateInfoEXT and pass the result to reportPipelineFeedback.
+  bool hasPipelineCreationFeedback() const { return pipelineCreationFeedbackEnabled_; }
+  void reportPipelineFeedback(const VkPipelineCreationFeedbackEXT &feedback);
+  uint32_t pipelineCacheHits() const { return pipelineCacheHits_; }
+  uint32_t pipelineCacheMisses() const { return pipelineCacheMisses_; }
+
+  // Shared, deduplicated shader modules. Pipelines get their VkShaderModules from here.
+  LveShaderLibrary &shaderLibrary() { return *shaderLibrary_; }
+  // Shared, deduplicated graphics pipelines, see LvePipelineRegistry.
+  LvePipelineRegistry &pipelineRegistry() { return *pipelineRegistry_; }
+  // Pipeline state settable per draw, see LveDynamicState.
+  const LveDynamicState &dynamicState() const { return *dynamicState_; }
+
+  LveAllocator &allocator() { return *allocator_; }
+  // Batches uploads/copies into as few submissions as possible, see LveUploadContext.
+  LveUploadContext &uploadContext() { return *uploadContext_; }
+
   // Buffer Helper Functions
+  // Memory comes from the device's LveAllocator, release it with destroyBuffer.
+  // sharedWithCompute buffers are written on computeQueue() and read on graphicsQueue(), they're
+  // concurrent between the two families when they differ, so no ownership transfer is needed.
   void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      LveAllocation &bufferAllocation,
+      bool sharedWithCompute = false);
+  void destroyBuffer(VkBuffer &buffer, LveAllocation &bufferAllocation);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-  void copyBufferToImage(
+  // Recorded into the upload context, they don't block. Wait on the returned ticket
+  // (uploadContext().wait(ticket)) before the destination is used.
+  UploadTicket copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  UploadTicket copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
+  // Memory comes from the device's LveAllocator, release it with destroyImage.
   void createImageWithInfo(
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      LveAllocation &imageAllocation);
+  void destroyImage(VkImage &image, LveAllocation &imageAllocation);
 
   VkPhysicalDeviceProperties properties;
 
  private:
+  void init();
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createAllocator();
+  void createUploadContext();
+  void createPipelineCache();
+  void createShaderLibrary();
+  void createPipelineRegistry();
+  void createDynamicState();
+  // Fills extendedDynamicStateSupport_ with what physicalDevice supports.
+  void queryExtendedDynamicStateSupport();
+  void savePipelineCache();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
+  uint64_t rateDeviceSuitability(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isInstanceExtensionAvailable(const char *extensionName);
+  bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName);
+  std::string pipelineCachePath();
+  bool isPipelineCacheDataValid(const std::vector<char> &data);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  LveWindow &window;
+  // nullptr when headless.
+  LveWindow *window;
   VkCommandPool commandPool;
+  VkCommandPool computeCommandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  VkQueue computeQueue_;
+  std::unique_ptr<LveAllocator> allocator_;
+  std::unique_ptr<LveUploadContext> uploadContext_;
+  std::unique_ptr<LveShaderLibrary> shaderLibrary_;
+  std::unique_ptr<LvePipelineRegistry> pipelineRegistry_;
+  std::unique_ptr<LveDynamicState> dynamicState_;
+  ExtendedDynamicStateSupport extendedDynamicStateSupport_;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  bool pipelineCreationFeedbackEnabled_ = false;
+  // Pipelines may be created from several threads.
+  std::atomic<uint32_t> pipelineCacheHits_{0};
+  std::atomic<uint32_t> pipelineCacheMisses_{0};
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME};
+  // Extensions a device must support to be picked, filled in init(). Swap chain only with a window.
+  std::vector<const char *> deviceExtensions;
 };
 
 }  // namespace lve
\ No newline at end of file
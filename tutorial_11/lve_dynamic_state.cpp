@@ -0,0 +1,136 @@
+#include "lve_dynamic_state.hpp"
+
+// std headers
+#include <stdexcept>
+#include <string>
+
+namespace lve {
+
+namespace {
+
+template <typename T>
+T loadDeviceFunction(VkDevice device, const char *name) {
+  auto function = reinterpret_cast<T>(vkGetDeviceProcAddr(device, name));
+  if (function == nullptr) {
+    throw std::runtime_error(std::string("failed to load ") + name);
+  }
+  return function;
+}
+
+// Grouped by the extension making them dynamic.
+void bakeExtendedState1(const DynamicPipelineState &state, PipelineConfigInfo &config_info) {
+  config_info.rasterizationInfo.cullMode = state.cullMode;
+  config_info.rasterizationInfo.frontFace = state.frontFace;
+  config_info.inputAssemblyInfo.topology = state.topology;
+  config_info.depthStencilInfo.depthTestEnable = state.depthTestEnable;
+  config_info.depthStencilInfo.depthWriteEnable = state.depthWriteEnable;
+  config_info.depthStencilInfo.depthCompareOp = state.depthCompareOp;
+}
+
+void bakeExtendedState2(const DynamicPipelineState &state, PipelineConfigInfo &config_info) {
+  config_info.rasterizationInfo.depthBiasEnable = state.depthBiasEnable;
+  config_info.inputAssemblyInfo.primitiveRestartEnable = state.primitiveRestartEnable;
+}
+
+void bakeExtendedState3(const DynamicPipelineState &state, PipelineConfigInfo &config_info) {
+  auto &blend_attachment = config_info.colorBlendAttachment;
+  blend_attachment.blendEnable = state.colorBlendEnable;
+  blend_attachment.srcColorBlendFactor = state.colorBlendEquation.srcColorBlendFactor;
+  blend_attachment.dstColorBlendFactor = state.colorBlendEquation.dstColorBlendFactor;
+  blend_attachment.colorBlendOp = state.colorBlendEquation.colorBlendOp;
+  blend_attachment.srcAlphaBlendFactor = state.colorBlendEquation.srcAlphaBlendFactor;
+  blend_attachment.dstAlphaBlendFactor = state.colorBlendEquation.dstAlphaBlendFactor;
+  blend_attachment.alphaBlendOp = state.colorBlendEquation.alphaBlendOp;
+  blend_attachment.colorWriteMask = state.colorWriteMask;
+}
+
+}  // namespace
+
+LveDynamicState::LveDynamicState(VkDevice device, const ExtendedDynamicStateSupport &support)
+    : support_{support} {
+  if (support_.state1) {
+    cmdSetCullMode_ = loadDeviceFunction<PFN_vkCmdSetCullModeEXT>(device, "vkCmdSetCullModeEXT");
+    cmdSetFrontFace_ = loadDeviceFunction<PFN_vkCmdSetFrontFaceEXT>(device, "vkCmdSetFrontFaceEXT");
+    cmdSetPrimitiveTopology_ =
+        loadDeviceFunction<PFN_vkCmdSetPrimitiveTopologyEXT>(device, "vkCmdSetPrimitiveTopologyEXT");
+    cmdSetDepthTestEnable_ =
+        loadDeviceFunction<PFN_vkCmdSetDepthTestEnableEXT>(device, "vkCmdSetDepthTestEnableEXT");
+    cmdSetDepthWriteEnable_ =
+        loadDeviceFunction<PFN_vkCmdSetDepthWriteEnableEXT>(device, "vkCmdSetDepthWriteEnableEXT");
+    cmdSetDepthCompareOp_ =
+        loadDeviceFunction<PFN_vkCmdSetDepthCompareOpEXT>(device, "vkCmdSetDepthCompareOpEXT");
+  }
+  if (support_.state2) {
+    cmdSetDepthBiasEnable_ =
+        loadDeviceFunction<PFN_vkCmdSetDepthBiasEnableEXT>(device, "vkCmdSetDepthBiasEnableEXT");
+    cmdSetPrimitiveRestartEnable_ = loadDeviceFunction<PFN_vkCmdSetPrimitiveRestartEnableEXT>(
+        device, "vkCmdSetPrimitiveRestartEnableEXT");
+  }
+  if (support_.state3) {
+    cmdSetColorBlendEnable_ =
+        loadDeviceFunction<PFN_vkCmdSetColorBlendEnableEXT>(device, "vkCmdSetColorBlendEnableEXT");
+    cmdSetColorBlendEquation_ =
+        loadDeviceFunction<PFN_vkCmdSetColorBlendEquationEXT>(device, "vkCmdSetColorBlendEquationEXT");
+    cmdSetColorWriteMask_ =
+        loadDeviceFunction<PFN_vkCmdSetColorWriteMaskEXT>(device, "vkCmdSetColorWriteMaskEXT");
+  }
+}
+
+void LveDynamicState::bake(const DynamicPipelineState &state, PipelineConfigInfo &config_info) {
+  bakeExtendedState1(state, config_info);
+  bakeExtendedState2(state, config_info);
+  bakeExtendedState3(state, config_info);
+}
+
+void LveDynamicState::makeDynamic(PipelineConfigInfo &config_info) const {
+  // Baked values of dynamic states are ignored, resetting them to the defaults keeps them out of
+  // LvePipelineRegistry's hash. The topology stays, its class(points/lines/triangles) still counts.
+  DynamicPipelineState canonical{};
+  canonical.topology = config_info.inputAssemblyInfo.topology;
+  auto &dynamic_states = config_info.dynamicStateEnables;
+  if (support_.state1) {
+    bakeExtendedState1(canonical, config_info);
+    dynamic_states.insert(dynamic_states.end(),
+                          {VK_DYNAMIC_STATE_CULL_MODE_EXT,
+                           VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+                           VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+                           VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+                           VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+                           VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT});
+  }
+  if (support_.state2) {
+    bakeExtendedState2(canonical, config_info);
+    dynamic_states.insert(dynamic_states.end(),
+                          {VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT,
+                           VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT});
+  }
+  if (support_.state3) {
+    bakeExtendedState3(canonical, config_info);
+    dynamic_states.insert(dynamic_states.end(),
+                          {VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+                           VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+                           VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT});
+  }
+}
+
+void LveDynamicState::apply(VkCommandBuffer command_buffer, const DynamicPipelineState &state) const {
+  if (support_.state1) {
+    cmdSetCullMode_(command_buffer, state.cullMode);
+    cmdSetFrontFace_(command_buffer, state.frontFace);
+    cmdSetPrimitiveTopology_(command_buffer, state.topology);
+    cmdSetDepthTestEnable_(command_buffer, state.depthTestEnable);
+    cmdSetDepthWriteEnable_(command_buffer, state.depthWriteEnable);
+    cmdSetDepthCompareOp_(command_buffer, state.depthCompareOp);
+  }
+  if (support_.state2) {
+    cmdSetDepthBiasEnable_(command_buffer, state.depthBiasEnable);
+    cmdSetPrimitiveRestartEnable_(command_buffer, state.primitiveRestartEnable);
+  }
+  if (support_.state3) {
+    cmdSetColorBlendEnable_(command_buffer, /*first attachment*/ 0, 1, &state.colorBlendEnable);
+    cmdSetColorBlendEquation_(command_buffer, /*first attachment*/ 0, 1, &state.colorBlendEquation);
+    cmdSetColorWriteMask_(command_buffer, /*first attachment*/ 0, 1, &state.colorWriteMask);
+  }
+}
+
+}  // namespace lve
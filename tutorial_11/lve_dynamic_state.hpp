@@ -0,0 +1,90 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+
+namespace lve {
+
+// Pipeline state render systems change between draws. Set per draw with LveDynamicState::apply on
+// devices with VK_EXT_extended_dynamic_state(1/2/3), baked into the pipeline otherwise.
+struct DynamicPipelineState {
+  // VK_EXT_extended_dynamic_state
+  VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+  VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+  // Only within the same class(triangles), the pipeline's topology decides the class.
+  VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  VkBool32 depthTestEnable = VK_TRUE;
+  VkBool32 depthWriteEnable = VK_TRUE;
+  VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+  // VK_EXT_extended_dynamic_state2
+  VkBool32 depthBiasEnable = VK_FALSE;
+  VkBool32 primitiveRestartEnable = VK_FALSE;
+  // VK_EXT_extended_dynamic_state3, single color attachment.
+  VkBool32 colorBlendEnable = VK_FALSE;
+  VkColorBlendEquationEXT colorBlendEquation = {VK_BLEND_FACTOR_ONE,
+                                                VK_BLEND_FACTOR_ZERO,
+                                                VK_BLEND_OP_ADD,
+                                                VK_BLEND_FACTOR_ONE,
+                                                VK_BLEND_FACTOR_ZERO,
+                                                VK_BLEND_OP_ADD};
+  VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                         VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  bool operator==(const DynamicPipelineState &other) const {
+    const VkColorBlendEquationEXT &a = colorBlendEquation;
+    const VkColorBlendEquationEXT &b = other.colorBlendEquation;
+    return cullMode == other.cullMode && frontFace == other.frontFace && topology == other.topology &&
+           depthTestEnable == other.depthTestEnable && depthWriteEnable == other.depthWriteEnable &&
+           depthCompareOp == other.depthCompareOp && depthBiasEnable == other.depthBiasEnable &&
+           primitiveRestartEnable == other.primitiveRestartEnable &&
+           colorBlendEnable == other.colorBlendEnable &&
+           a.srcColorBlendFactor == b.srcColorBlendFactor && a.dstColorBlendFactor == b.dstColorBlendFactor &&
+           a.colorBlendOp == b.colorBlendOp && a.srcAlphaBlendFactor == b.srcAlphaBlendFactor &&
+           a.dstAlphaBlendFactor == b.dstAlphaBlendFactor && a.alphaBlendOp == b.alphaBlendOp &&
+           colorWriteMask == other.colorWriteMask;
+  }
+  bool operator!=(const DynamicPipelineState &other) const { return !(*this == other); }
+};
+
+// Collapses pipeline permutations that only differ by DynamicPipelineState, owned by LveDevice.
+// Pipelines opt in with makeDynamic: whatever the device supports becomes dynamic state and is
+// reset to one canonical value in the config, so LvePipelineRegistry hands every such request the
+// same pipeline. The rest stays baked, so configs should be filled with bake first.
+// Shader objects(VK_EXT_shader_object) would remove the pipelines altogether, but need a
+// different binding model than LvePipeline, so they're not used.
+class LveDynamicState {
+ public:
+  LveDynamicState(VkDevice device, const ExtendedDynamicStateSupport &support);
+
+  LveDynamicState(const LveDynamicState &) = delete;
+  LveDynamicState &operator=(const LveDynamicState &) = delete;
+
+  const ExtendedDynamicStateSupport &support() const { return support_; }
+  // False when nothing can be dynamic, each state needs its own pipeline then.
+  bool isAvailable() const { return support_.state1; }
+  // True when every DynamicPipelineState field is dynamic, all states share one pipeline then.
+  bool isComplete() const { return support_.state1 && support_.state2 && support_.state3; }
+
+  // Writes state into config_info, what the pipeline uses for anything that isn't dynamic.
+  static void bake(const DynamicPipelineState &state, PipelineConfigInfo &config_info);
+  // Marks the supported states dynamic, apply has to be called after binding the pipeline then.
+  void makeDynamic(PipelineConfigInfo &config_info) const;
+  // Records the supported states. Only valid with pipelines that went through makeDynamic.
+  void apply(VkCommandBuffer command_buffer, const DynamicPipelineState &state) const;
+
+ private:
+  ExtendedDynamicStateSupport support_;
+  // Extension commands aren't exported by the loader, they come from vkGetDeviceProcAddr.
+  PFN_vkCmdSetCullModeEXT cmdSetCullMode_ = nullptr;
+  PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace_ = nullptr;
+  PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology_ = nullptr;
+  PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable_ = nullptr;
+  PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable_ = nullptr;
+  PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp_ = nullptr;
+  PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnable_ = nullptr;
+  PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable_ = nullptr;
+  PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable_ = nullptr;
+  PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquation_ = nullptr;
+  PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask_ = nullptr;
+};
+
+}  // namespace lve
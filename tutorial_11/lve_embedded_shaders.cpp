@@ -0,0 +1,35 @@
+#include "lve_embedded_shaders.hpp"
+
+// std headers
+#include <cstring>
+
+namespace lve {
+
+namespace {
+
+struct EmbeddedShader {
+  const char *filePath;
+  const uint32_t *code;
+  size_t size;
+};
+
+#ifdef LVE_EMBEDDED_SHADERS
+// Generated by the Makefile: includes every shaders/*.spv.hpp and defines kEmbeddedShaders.
+#include "shaders/embedded_shaders.inc"
+#else
+constexpr EmbeddedShader kEmbeddedShaders[] = {{nullptr, nullptr, 0}};
+#endif
+
+}  // namespace
+
+SpirvSpan findEmbeddedShader(const std::string &file_path) {
+  // A handful of shaders, a linear search is fine.
+  for (const auto &shader : kEmbeddedShaders) {
+    if (shader.filePath != nullptr && strcmp(shader.filePath, file_path.c_str()) == 0) {
+      return {shader.code, shader.size};
+    }
+  }
+  return {};
+}
+
+}  // namespace lve
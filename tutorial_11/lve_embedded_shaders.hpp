@@ -0,0 +1,17 @@
+#pragma once
+
+#include "lve_shader_library.hpp"
+
+// std lib headers
+#include <string>
+
+namespace lve {
+
+// SPIR-V compiled into the binary. Built with `make EMBED_SHADERS=1`, which turns every .spv into
+// a constexpr uint32_t array header(shaders/*.spv.hpp) and defines LVE_EMBEDDED_SHADERS.
+// Looked up by the path the .spv was generated at, e.g "shaders/simple_shader.vert.spv", so
+// LveShaderLibrary::load serves them without touching the file system.
+// Returns an empty span for unknown paths and in builds without embedded shaders.
+SpirvSpan findEmbeddedShader(const std::string &file_path);
+
+}  // namespace lve
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "lve_dynamic_state.hpp"
 #include "lve_model.hpp"
 
 #include <memory>
@@ -23,6 +24,19 @@ struct Transform2DComponent {
     }
 };
 
+// How SimpleRendererSystem draws the object. vertexColors/applyTransform combinations are shader
+// variants(SimpleShaderConstants), so the shaders don't branch on them per vertex/fragment.
+struct MaterialComponent {
+    // Interpolated vertex colors instead of color_.
+    bool vertexColors = false;
+    // False for vertices that are already in place, e.g written by a compute shader. Only the
+    // translation is applied then.
+    bool applyTransform = true;
+    // Cull mode, depth test, blending etc. Set per draw with extended dynamic state, without it
+    // each distinct state is another pipeline.
+    DynamicPipelineState pipelineState{};
+};
+
 class LveGameObject {
     public:
         using id_t = unsigned int;
@@ -42,6 +56,7 @@ class LveGameObject {
         glm::vec3 color_{};
         std::shared_ptr<LveModel> lve_model_{};
         Transform2DComponent transform2d_{};
+        MaterialComponent material_{};
     private:
         LveGameObject(id_t objId) : id_(objId) {}
         id_t id_;
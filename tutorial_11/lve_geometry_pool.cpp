@@ -0,0 +1,205 @@
+#include "lve_geometry_pool.hpp"
+#include "lve_upload_context.hpp"
+
+// std headers
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve {
+
+LveRangeAllocator::LveRangeAllocator(uint32_t capacity) {
+  free_ranges_[0] = capacity;
+}
+
+bool LveRangeAllocator::allocate(uint32_t count, uint32_t *offset) {
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it) {
+    if (it->second < count) {
+      continue;
+    }
+    *offset = it->first;
+    uint32_t remaining = it->second - count;
+    free_ranges_.erase(it);
+    if (remaining > 0) {
+      free_ranges_[*offset + count] = remaining;
+    }
+    return true;
+  }
+  return false;
+}
+
+void LveRangeAllocator::free(uint32_t offset, uint32_t count) {
+  auto next = free_ranges_.lower_bound(offset);
+  // Merge with the free range right after.
+  if (next != free_ranges_.end() && offset + count == next->first) {
+    count += next->second;
+    next = free_ranges_.erase(next);
+  }
+  // And with the one right before.
+  if (next != free_ranges_.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += count;
+      return;
+    }
+  }
+  free_ranges_.emplace_hint(next, offset, count);
+}
+
+LveGeometryPool::LveGeometryPool(LveDevice &device,
+                                 uint32_t vertex_stride,
+                                 uint32_t vertex_capacity,
+                                 uint32_t index_capacity)
+    : LveGeometryPool{device, vertex_stride, /*attribute_stride*/ 0, vertex_capacity, index_capacity} {}
+
+LveGeometryPool::LveGeometryPool(LveDevice &device,
+                                 uint32_t vertex_stride,
+                                 uint32_t attribute_stride,
+                                 uint32_t vertex_capacity,
+                                 uint32_t index_capacity)
+    : lve_device_{device},
+      vertex_stride_{vertex_stride},
+      attribute_stride_{attribute_stride},
+      is_direct_write_{device.allocator().hasLargeHostVisibleDeviceLocalMemory()},
+      vertex_ranges_{vertex_capacity},
+      index_ranges_{index_capacity} {
+  createBuffer(static_cast<VkDeviceSize>(vertex_capacity) * vertex_stride_,
+               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+               vertex_buffer_,
+               vertex_buffer_allocation_);
+  if (attribute_stride_ > 0) {
+    createBuffer(static_cast<VkDeviceSize>(vertex_capacity) * attribute_stride_,
+                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 attribute_buffer_,
+                 attribute_buffer_allocation_);
+  }
+  createBuffer(static_cast<VkDeviceSize>(index_capacity) * sizeof(uint32_t),
+               VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+               index_buffer_,
+               index_buffer_allocation_);
+}
+
+LveGeometryPool::~LveGeometryPool() {
+  if (upload_ticket_ != 0) {
+    lve_device_.uploadContext().wait(upload_ticket_);
+  }
+  lve_device_.destroyBuffer(vertex_buffer_, vertex_buffer_allocation_);
+  if (attribute_buffer_ != VK_NULL_HANDLE) {
+    lve_device_.destroyBuffer(attribute_buffer_, attribute_buffer_allocation_);
+  }
+  lve_device_.destroyBuffer(index_buffer_, index_buffer_allocation_);
+}
+
+void LveGeometryPool::createBuffer(
+    VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer, LveAllocation &allocation) {
+  // Same placement as static LveModel buffers: VRAM, host visible when the whole of it is.
+  VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  if (is_direct_write_) {
+    properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  } else {
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  }
+  lve_device_.createBuffer(size, usage, properties, buffer, allocation);
+}
+
+void LveGeometryPool::write(VkBuffer buffer,
+                            const LveAllocation &allocation,
+                            VkDeviceSize offset,
+                            const void *data,
+                            VkDeviceSize size) {
+  if (is_direct_write_) {
+    memcpy(static_cast<char *>(allocation.mapped) + offset, data, static_cast<size_t>(size));
+    return;
+  }
+  // Tickets only grow, the last one covers every earlier copy.
+  upload_ticket_ = lve_device_.uploadContext().uploadBuffer(buffer, offset, data, size);
+}
+
+GeometryRange LveGeometryPool::allocate(const void *vertices,
+                                        uint32_t vertex_count,
+                                        const uint32_t *indices,
+                                        uint32_t index_count,
+                                        const void *attributes) {
+  if ((attributes != nullptr) != (attribute_stride_ > 0)) {
+    throw std::runtime_error("attributes must be given exactly when the geometry pool is split!");
+  }
+  GeometryRange range{};
+  range.vertexCount = vertex_count;
+  range.indexCount = index_count;
+  if (!vertex_ranges_.allocate(vertex_count, &range.firstVertex)) {
+    throw std::runtime_error("geometry pool is out of vertex space!");
+  }
+  if (!index_ranges_.allocate(index_count, &range.firstIndex)) {
+    vertex_ranges_.free(range.firstVertex, vertex_count);
+    throw std::runtime_error("geometry pool is out of index space!");
+  }
+  write(vertex_buffer_,
+        vertex_buffer_allocation_,
+        static_cast<VkDeviceSize>(range.firstVertex) * vertex_stride_,
+        vertices,
+        static_cast<VkDeviceSize>(vertex_count) * vertex_stride_);
+  if (attribute_buffer_ != VK_NULL_HANDLE) {
+    write(attribute_buffer_,
+          attribute_buffer_allocation_,
+          static_cast<VkDeviceSize>(range.firstVertex) * attribute_stride_,
+          attributes,
+          static_cast<VkDeviceSize>(vertex_count) * attribute_stride_);
+  }
+  write(index_buffer_,
+        index_buffer_allocation_,
+        static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t),
+        indices,
+        static_cast<VkDeviceSize>(index_count) * sizeof(uint32_t));
+  return range;
+}
+
+void LveGeometryPool::free(const GeometryRange &range) {
+  if (!defer_release_) {
+    freeRange(range);
+    return;
+  }
+  // Nothing to keep alive, the deleter runs once the frames in flight are done.
+  defer_release_(std::shared_ptr<void>(nullptr, [this, range](void *) { freeRange(range); }));
+}
+
+void LveGeometryPool::freeRange(const GeometryRange &range) {
+  vertex_ranges_.free(range.firstVertex, range.vertexCount);
+  index_ranges_.free(range.firstIndex, range.indexCount);
+}
+
+void LveGeometryPool::submitUploads() {
+  if (upload_ticket_ != 0) {
+    // No host wait, the frame is submitted after the upload and the GPU orders it behind it.
+    lve_device_.uploadContext().submit(upload_ticket_);
+    if (lve_device_.uploadContext().isComplete(upload_ticket_)) {
+      upload_ticket_ = 0;
+    }
+  }
+}
+
+void LveGeometryPool::bind(VkCommandBuffer command_buffer) {
+  submitUploads();
+  VkBuffer buffers[] = {vertex_buffer_, attribute_buffer_};
+  VkDeviceSize offsets[] = {0, 0};
+  uint32_t binding_count = attribute_buffer_ != VK_NULL_HANDLE ? 2 : 1;
+  vkCmdBindVertexBuffers(command_buffer, /*firstBinding*/ 0, binding_count, buffers, offsets);
+  vkCmdBindIndexBuffer(command_buffer, index_buffer_, /*offset*/ 0, VK_INDEX_TYPE_UINT32);
+}
+
+void LveGeometryPool::bindPositions(VkCommandBuffer command_buffer) {
+  submitUploads();
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(command_buffer, /*firstBinding*/ 0, /*bindingCount*/ 1, &vertex_buffer_, &offset);
+  vkCmdBindIndexBuffer(command_buffer, index_buffer_, /*offset*/ 0, VK_INDEX_TYPE_UINT32);
+}
+
+void LveGeometryPool::draw(VkCommandBuffer command_buffer, const GeometryRange &range) {
+  vkCmdDrawIndexed(command_buffer,
+                   range.indexCount,
+                   /*num_of_instance*/ 1,
+                   range.firstIndex,
+                   static_cast<int32_t>(range.firstVertex),
+                   /*first_instance*/ 0);
+}
+
+}  // namespace lve
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace lve {
+
+// First fit allocator over [0, capacity) in whole elements. Free neighbours are merged, so the
+// free list stays short as long as models are freed about as often as they're created.
+class LveRangeAllocator {
+ public:
+  explicit LveRangeAllocator(uint32_t capacity);
+
+  // False when no free range is big enough.
+  bool allocate(uint32_t count, uint32_t *offset);
+  void free(uint32_t offset, uint32_t count);
+
+ private:
+  // offset -> count
+  std::map<uint32_t, uint32_t> free_ranges_;
+};
+
+// Where a model's data is inside LveGeometryPool, in vertices and indices(not bytes).
+// Indices are relative to firstVertex, which vkCmdDrawIndexed adds as vertexOffset.
+struct GeometryRange {
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+};
+
+// One big vertex buffer and one big index buffer shared by many models, owned by the app.
+// With an attribute stride the vertices are split(VertexStreams::kSplit): positions in the vertex
+// buffer at binding 0, the other attributes in a second buffer at binding 1.
+// Models are ranges inside them, so the buffers are bound once per frame instead of once per
+// object, and every model can be drawn from a single indirect/multi draw.
+// Stored in DEVICE_LOCAL memory, written through the upload context(or directly with resizable
+// BAR). Not thread safe.
+class LveGeometryPool {
+ public:
+  // 64k vertices and 256k indices, 1.5 MB with float vertices. Scenes with more geometry pass
+  // their own capacities.
+  static constexpr uint32_t kDefaultVertexCapacity = 1u << 16;
+  static constexpr uint32_t kDefaultIndexCapacity = 1u << 18;
+
+  // vertex_stride in bytes. Indices are always 32 bit, 16 bit would limit the pool to 64k vertices.
+  LveGeometryPool(LveDevice &device,
+                  uint32_t vertex_stride,
+                  uint32_t vertex_capacity = kDefaultVertexCapacity,
+                  uint32_t index_capacity = kDefaultIndexCapacity);
+  // Split streams, vertex_stride bytes of position and attribute_stride bytes of the rest per vertex.
+  LveGeometryPool(LveDevice &device,
+                  uint32_t vertex_stride,
+                  uint32_t attribute_stride,
+                  uint32_t vertex_capacity,
+                  uint32_t index_capacity);
+  ~LveGeometryPool();
+
+  LveGeometryPool(const LveGeometryPool &) = delete;
+  LveGeometryPool &operator=(const LveGeometryPool &) = delete;
+
+  // Copies vertex_count vertices(vertex_stride bytes each) and index_count indices into the pool.
+  // Split pools also copy vertex_count attributes(attribute_stride bytes each). Throws when the
+  // pool is full.
+  GeometryRange allocate(const void *vertices,
+                         uint32_t vertex_count,
+                         const uint32_t *indices,
+                         uint32_t index_count,
+                         const void *attributes = nullptr);
+  // Frees range once no frame in flight draws from it anymore, through the deferRelease hook.
+  // Right away without one.
+  void free(const GeometryRange &range);
+  // Where free hands its ranges to, e.g LveRenderer::deferRelease. The owner of the hook must
+  // release them before the pool is destroyed. Pools without a hook may only free ranges when
+  // the GPU is idle.
+  void setDeferRelease(std::function<void(std::shared_ptr<void>)> defer_release) {
+    defer_release_ = std::move(defer_release);
+  }
+
+  // Binds the vertex buffer at binding 0, the attribute buffer at binding 1 and the index buffer.
+  // Submits pending uploads first.
+  void bind(VkCommandBuffer command_buffer);
+  // Only the vertex buffer(positions of split pools) and the index buffer, for depth-only passes.
+  void bindPositions(VkCommandBuffer command_buffer);
+  void draw(VkCommandBuffer command_buffer, const GeometryRange &range);
+
+  uint32_t vertexStride() const { return vertex_stride_; }
+  // 0 when the pool is interleaved.
+  uint32_t attributeStride() const { return attribute_stride_; }
+  VkBuffer vertexBuffer() const { return vertex_buffer_; }
+  // VK_NULL_HANDLE when the pool is interleaved.
+  VkBuffer attributeBuffer() const { return attribute_buffer_; }
+  VkBuffer indexBuffer() const { return index_buffer_; }
+
+ private:
+  void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer, LveAllocation &allocation);
+  // Writes data at offset of buffer, directly when it's mapped.
+  void write(VkBuffer buffer, const LveAllocation &allocation, VkDeviceSize offset, const void *data, VkDeviceSize size);
+  // Submits the pending uploads without waiting for them.
+  void submitUploads();
+  void freeRange(const GeometryRange &range);
+
+  LveDevice &lve_device_;
+  uint32_t vertex_stride_;
+  uint32_t attribute_stride_;
+  bool is_direct_write_;
+  VkBuffer vertex_buffer_;
+  LveAllocation vertex_buffer_allocation_;
+  VkBuffer attribute_buffer_ = VK_NULL_HANDLE;
+  LveAllocation attribute_buffer_allocation_;
+  VkBuffer index_buffer_;
+  LveAllocation index_buffer_allocation_;
+  LveRangeAllocator vertex_ranges_;
+  LveRangeAllocator index_ranges_;
+  // Last upload into the pool still to be submitted or finished, 0 when there's none.
+  UploadTicket upload_ticket_ = 0;
+  std::function<void(std::shared_ptr<void>)> defer_release_;
+};
+
+}  // namespace lve
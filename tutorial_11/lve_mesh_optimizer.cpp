@@ -0,0 +1,281 @@
+#include "lve_mesh_optimizer.hpp"
+
+// std headers
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve {
+
+namespace {
+
+// FIFO post-transform cache. A vertex is cached while fewer than cache_size misses happened since
+// it was last loaded.
+class VertexCacheSimulator {
+ public:
+  VertexCacheSimulator(size_t vertex_count, uint32_t cache_size)
+      : loaded_at_(vertex_count, 0), cache_size_{cache_size}, timestamp_{cache_size + 1} {}
+
+  // True on a miss, i.e when the vertex shader runs for vertex.
+  bool access(uint32_t vertex) {
+    if (timestamp_ - loaded_at_[vertex] <= cache_size_) {
+      return false;
+    }
+    loaded_at_[vertex] = timestamp_++;
+    return true;
+  }
+  // Misses of the three vertices of triangle.
+  uint32_t accessTriangle(const uint32_t *triangle) {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+  // Misses since vertex was loaded, bigger is older. > cache_size when it's not cached.
+  uint32_t age(uint32_t vertex) const { return timestamp_ - loaded_at_[vertex]; }
+  // Empties the cache.
+  void reset() { timestamp_ += cache_size_ + 1; }
+
+ private:
+  std::vector<uint32_t> loaded_at_;
+  uint32_t cache_size_;
+  uint32_t timestamp_;
+};
+
+size_t VertexCountOf(const std::vector<uint32_t> &indices) {
+  return indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) + 1;
+}
+
+// Triangles using each vertex, triangles[offsets[v]..offsets[v + 1]) for vertex v.
+struct TriangleAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency BuildTriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertex_count) {
+  TriangleAdjacency adjacency{};
+  adjacency.offsets.assign(vertex_count + 1, 0);
+  for (uint32_t index : indices) {
+    adjacency.offsets[index + 1]++;
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    adjacency.offsets[v + 1] += adjacency.offsets[v];
+  }
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+  return adjacency;
+}
+
+}  // namespace
+
+float computeAcmr(const std::vector<uint32_t> &indices, uint32_t cache_size) {
+  assert(indices.size() % 3 == 0 && "Indices must be a triangle list.");
+  if (indices.empty()) {
+    return 0.0f;
+  }
+  VertexCacheSimulator cache{VertexCountOf(indices), cache_size};
+  uint32_t misses = 0;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    misses += cache.accessTriangle(&indices[i]);
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          size_t vertex_count,
+                                          uint32_t cache_size) {
+  assert(indices.size() % 3 == 0 && "Indices must be a triangle list.");
+  const TriangleAdjacency adjacency = BuildTriangleAdjacency(indices, vertex_count);
+  // Triangles not emitted yet per vertex.
+  std::vector<uint32_t> live_triangles(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    live_triangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<bool> emitted(indices.size() / 3, false);
+  // Recently emitted vertices, where to continue when the fanning vertex has no triangles left.
+  std::vector<uint32_t> dead_end_stack;
+  std::vector<uint32_t> candidates;
+  // Next vertex to try when the dead end stack is empty too, vertices before it have no triangles.
+  size_t input_cursor = 0;
+  VertexCacheSimulator cache{vertex_count, cache_size};
+
+  std::vector<uint32_t> optimized;
+  optimized.reserve(indices.size());
+  auto skip_dead_end = [&]() -> int64_t {
+    while (!dead_end_stack.empty()) {
+      uint32_t vertex = dead_end_stack.back();
+      dead_end_stack.pop_back();
+      if (live_triangles[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for (; input_cursor < vertex_count; input_cursor++) {
+      if (live_triangles[input_cursor] > 0) {
+        return static_cast<int64_t>(input_cursor);
+      }
+    }
+    return -1;
+  };
+
+  int64_t fanning_vertex = skip_dead_end();
+  while (fanning_vertex >= 0) {
+    candidates.clear();
+    for (uint32_t k = adjacency.offsets[fanning_vertex]; k < adjacency.offsets[fanning_vertex + 1]; k++) {
+      uint32_t triangle = adjacency.triangles[k];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        uint32_t vertex = indices[3 * triangle + corner];
+        optimized.push_back(vertex);
+        dead_end_stack.push_back(vertex);
+        candidates.push_back(vertex);
+        live_triangles[vertex]--;
+        cache.access(vertex);
+      }
+    }
+    // Next fan around the candidate that stays cached the longest while its remaining
+    // triangles(up to 2 new vertices each) are emitted, the oldest cached one wins.
+    fanning_vertex = -1;
+    int64_t best_priority = -1;
+    for (uint32_t vertex : candidates) {
+      if (live_triangles[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (cache.age(vertex) + 2 * live_triangles[vertex] <= cache_size) {
+        priority = cache.age(vertex);
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning_vertex = vertex;
+      }
+    }
+    if (fanning_vertex < 0) {
+      fanning_vertex = skip_dead_end();
+    }
+  }
+  assert(optimized.size() == indices.size() && "Every triangle must be emitted once.");
+  return optimized;
+}
+
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t> &indices,
+                                       const std::vector<float> &positions,
+                                       float threshold,
+                                       uint32_t cache_size) {
+  assert(indices.size() % 3 == 0 && "Indices must be a triangle list.");
+  const size_t triangle_count = indices.size() / 3;
+  const size_t vertex_count = positions.size() / 3;
+  if (triangle_count == 0) {
+    return indices;
+  }
+
+  // Hard boundaries: the first triangle and triangles missing all 3 vertices, where the cache
+  // order restarts anyway.
+  std::vector<size_t> hard_boundaries;
+  VertexCacheSimulator cache{vertex_count, cache_size};
+  for (size_t t = 0; t < triangle_count; t++) {
+    if (cache.accessTriangle(&indices[3 * t]) == 3 || t == 0) {
+      hard_boundaries.push_back(t);
+    }
+  }
+  hard_boundaries.push_back(triangle_count);
+
+  // Soft boundaries: cut a hard cluster as soon as the part since the last cut has an ACMR within
+  // threshold of the whole cluster's, so reordering the parts costs little cache efficiency.
+  std::vector<size_t> cluster_starts;
+  for (size_t h = 0; h + 1 < hard_boundaries.size(); h++) {
+    const size_t start = hard_boundaries[h];
+    const size_t end = hard_boundaries[h + 1];
+    cache.reset();
+    uint32_t cluster_misses = 0;
+    for (size_t t = start; t < end; t++) {
+      cluster_misses += cache.accessTriangle(&indices[3 * t]);
+    }
+    const float max_acmr = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - start);
+    cache.reset();
+    cluster_starts.push_back(start);
+    uint32_t running_misses = 0;
+    uint32_t running_triangles = 0;
+    for (size_t t = start; t < end; t++) {
+      running_misses += cache.accessTriangle(&indices[3 * t]);
+      running_triangles++;
+      if (t + 1 < end && static_cast<float>(running_misses) <= max_acmr * static_cast<float>(running_triangles)) {
+        cluster_starts.push_back(t + 1);
+        running_misses = 0;
+        running_triangles = 0;
+        cache.reset();
+      }
+    }
+  }
+  cluster_starts.push_back(triangle_count);
+
+  float mesh_center[3] = {0.0f, 0.0f, 0.0f};
+  for (size_t v = 0; v < vertex_count; v++) {
+    for (int axis = 0; axis < 3; axis++) {
+      mesh_center[axis] += positions[3 * v + axis] / static_cast<float>(vertex_count);
+    }
+  }
+
+  // Clusters facing away from the center are on the outside and drawn first.
+  struct Cluster {
+    size_t start;
+    size_t end;
+    float sort_key;
+  };
+  std::vector<Cluster> clusters;
+  for (size_t c = 0; c + 1 < cluster_starts.size(); c++) {
+    float centroid[3] = {0.0f, 0.0f, 0.0f};
+    float normal[3] = {0.0f, 0.0f, 0.0f};
+    float area_sum = 0.0f;
+    for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+      const float *p0 = &positions[3 * indices[3 * t]];
+      const float *p1 = &positions[3 * indices[3 * t + 1]];
+      const float *p2 = &positions[3 * indices[3 * t + 2]];
+      const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      // Cross product, its length is twice the triangle's area: normals and centroids are area weighted.
+      const float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int axis = 0; axis < 3; axis++) {
+        centroid[axis] += area * (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+        normal[axis] += n[axis];
+      }
+      area_sum += area;
+    }
+    const float normal_length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    float sort_key = 0.0f;
+    if (area_sum > 0.0f && normal_length > 0.0f) {
+      for (int axis = 0; axis < 3; axis++) {
+        sort_key += (centroid[axis] / area_sum - mesh_center[axis]) * normal[axis] / normal_length;
+      }
+    }
+    clusters.push_back({cluster_starts[c], cluster_starts[c + 1], sort_key});
+  }
+  std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+    return a.sort_key > b.sort_key;
+  });
+
+  std::vector<uint32_t> optimized;
+  optimized.reserve(indices.size());
+  for (const Cluster &cluster : clusters) {
+    optimized.insert(optimized.end(), indices.begin() + 3 * cluster.start, indices.begin() + 3 * cluster.end);
+  }
+  assert(optimized.size() == indices.size() && "Clusters must cover every triangle.");
+  return optimized;
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertex_count) {
+  std::vector<uint32_t> remap(vertex_count, kUnusedVertex);
+  uint32_t next_vertex = 0;
+  for (uint32_t &index : indices) {
+    if (remap[index] == kUnusedVertex) {
+      remap[index] = next_vertex++;
+    }
+    index = remap[index];
+  }
+  return remap;
+}
+
+}  // namespace lve
@@ -0,0 +1,65 @@
+#pragma once
+
+// std lib headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Triangle order and vertex order of indexed triangle lists. Cache friendly triangles are shaded
+// from the post-transform cache instead of running the vertex shader again, outer triangles drawn
+// first cut overdraw, vertices in first use order make vertex fetch sequential. The mesh looks the
+// same, only the order changes.
+// No Vulkan dependency, an offline asset converter can run the same passes.
+
+// Post-transform cache size the passes optimize for. Real GPUs vary, 16-32 entries FIFO-like.
+constexpr uint32_t kVertexCacheSize = 16;
+
+// Average cache miss ratio: vertex shader invocations per triangle with a FIFO cache of
+// cache_size entries. 3 without any reuse, 0.5-0.7 for well ordered dense meshes.
+float computeAcmr(const std::vector<uint32_t> &indices, uint32_t cache_size = kVertexCacheSize);
+
+// Tipsify(Sander et al. 2007): fans around the vertex most likely still in the cache, linear in
+// the index count. Returns the triangles of indices reordered.
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          size_t vertex_count,
+                                          uint32_t cache_size = kVertexCacheSize);
+
+// Cuts the cache optimized indices into clusters whose own ACMR is at most threshold times the
+// mesh's, then draws the clusters facing away from the mesh center first, so they occlude the
+// ones behind. positions are xyz per vertex. Flat(z = 0) meshes keep their order.
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t> &indices,
+                                       const std::vector<float> &positions,
+                                       float threshold = 1.05f,
+                                       uint32_t cache_size = kVertexCacheSize);
+
+// Renumbers vertices in the order indices first use them and rewrites indices. Returns the
+// old -> new table, kUnusedVertex for vertices no triangle uses(apply it with remapVertices).
+constexpr uint32_t kUnusedVertex = ~0u;
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertex_count);
+
+template <typename T>
+std::vector<T> remapVertices(const std::vector<T> &vertices, const std::vector<uint32_t> &remap) {
+  size_t used_count = 0;
+  for (uint32_t new_index : remap) {
+    used_count += new_index != kUnusedVertex;
+  }
+  std::vector<T> remapped(used_count);
+  for (size_t i = 0; i < vertices.size(); i++) {
+    if (remap[i] != kUnusedVertex) {
+      remapped[remap[i]] = vertices[i];
+    }
+  }
+  return remapped;
+}
+
+// ACMR before and after LveModel::Builder::optimize.
+struct MeshOptimizationReport {
+  uint32_t triangleCount = 0;
+  uint32_t vertexCount = 0;
+  float acmrBefore = 0.0f;
+  float acmrAfter = 0.0f;
+};
+
+}  // namespace lve
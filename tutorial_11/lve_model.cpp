@@ -1,77 +1,412 @@
 #include "lve_model.hpp"
+#include "lve_upload_context.hpp"
 
+// std headers
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <utility>
 
 namespace lve {
-    LveModel::LveModel(LveDevice &device, const std::vector<Vertex> &vertices) : lve_device_(device){
-        createVertexBuffers(vertices);
+    size_t LveModel::Vertex::Hash::operator()(const Vertex &vertex) const {
+        // std::hash<float> hashes 0.0f and -0.0f the same, matching operator==.
+        size_t seed = 0;
+        auto combine = [&seed](float value) {
+            seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        };
+        combine(vertex.position_.x);
+        combine(vertex.position_.y);
+        combine(vertex.color_.r);
+        combine(vertex.color_.g);
+        combine(vertex.color_.b);
+        return seed;
+    }
+
+    void LveModel::Builder::addVertex(const Vertex &vertex) {
+        auto inserted = vertex_indices_.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+        if (inserted.second) {
+            vertices.push_back(vertex);
+        }
+        indices.push_back(inserted.first->second);
+    }
+
+    void LveModel::Builder::addTriangleList(const std::vector<Vertex> &triangle_list) {
+        vertex_indices_.reserve(vertex_indices_.size() + triangle_list.size());
+        indices.reserve(indices.size() + triangle_list.size());
+        for (const auto &vertex : triangle_list) {
+            addVertex(vertex);
+        }
+    }
+
+    MeshOptimizationReport LveModel::Builder::optimize() {
+        MeshOptimizationReport report{};
+        report.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        report.vertexCount = static_cast<uint32_t>(vertices.size());
+        if (indices.empty()) {
+            return report;
+        }
+        report.acmrBefore = computeAcmr(indices);
+        // Overdraw sorting works in 3D, the 2D positions get z = 0.
+        std::vector<float> positions(vertices.size() * 3, 0.0f);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[3 * i] = vertices[i].position_.x;
+            positions[3 * i + 1] = vertices[i].position_.y;
+        }
+        const size_t index_count = indices.size();
+        auto check_triangle_count = [&]() {
+            if (indices.size() != index_count) {
+                throw std::runtime_error("mesh optimizer changed the triangle count!");
+            }
+        };
+        // Tipsify is a heuristic, meshes already in a cache friendly order(e.g hierarchically
+        // generated ones) can come out worse, keep their order then.
+        std::vector<uint32_t> cache_optimized = optimizeVertexCache(indices, vertices.size());
+        if (computeAcmr(cache_optimized) < report.acmrBefore) {
+            indices = std::move(cache_optimized);
+        }
+        check_triangle_count();
+        indices = optimizeOverdraw(indices, positions);
+        check_triangle_count();
+        std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertices.size());
+        vertices = remapVertices(vertices, remap);
+        // Keep welding later vertices against the renumbered ones.
+        for (auto it = vertex_indices_.begin(); it != vertex_indices_.end();) {
+            if (remap[it->second] == kUnusedVertex) {
+                it = vertex_indices_.erase(it);
+                continue;
+            }
+            it->second = remap[it->second];
+            ++it;
+        }
+        report.vertexCount = static_cast<uint32_t>(vertices.size());
+        report.acmrAfter = computeAcmr(indices);
+        return report;
+    }
+
+    LveModel::LveModel(LveDevice &device, const Builder &builder, MemoryUsage memory_usage)
+        : lve_device_(device), vertex_format_(builder.vertexFormat), vertex_streams_(builder.vertexStreams){
+        createVertexBuffers(builder.vertices, memory_usage);
+        createIndexBuffers(builder.indices, memory_usage);
+    }
+
+    LveModel::LveModel(LveDevice &device, const std::vector<Vertex> &vertices, MemoryUsage memory_usage)
+        : lve_device_(device){
+        if (memory_usage == MemoryUsage::kStreaming) {
+            createVertexBuffers(vertices, memory_usage);
+            return;
+        }
+        Builder builder{};
+        builder.addTriangleList(vertices);
+        createVertexBuffers(builder.vertices, memory_usage);
+        createIndexBuffers(builder.indices, memory_usage);
+    }
+
+    LveModel::LveModel(LveDevice &device, uint32_t vertex_count, VertexFormat vertex_format)
+        : lve_device_(device), vertex_format_(vertex_format), vertex_count_(vertex_count){
+        assert(vertex_count_ >= 3 && "Vertex count must at least be 3 to form a triangle.");
+        // Written by compute and read by the vertex input stage every frame, VRAM only.
+        lve_device_.createBuffer(static_cast<VkDeviceSize>(vertex_count_) * vertexStride(vertex_format_),
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 vertex_buffer_,
+                                 vertex_buffer_allocation_,
+                                 /*sharedWithCompute*/ true);
+    }
+
+    LveModel::LveModel(LveDevice &device, LveGeometryPool &geometry_pool, const Builder &builder)
+        : lve_device_(device),
+          vertex_format_(builder.vertexFormat),
+          vertex_streams_(builder.vertexStreams),
+          geometry_pool_(&geometry_pool){
+        vertex_count_ = static_cast<uint32_t>(builder.vertices.size());
+        index_count_ = static_cast<uint32_t>(builder.indices.size());
+        std::vector<uint8_t> encoded = EncodeVertices(builder.vertices, vertex_format_);
+        if (vertex_streams_ == VertexStreams::kSplit) {
+            assert(positionStreamStride(vertex_format_) == geometry_pool.vertexStride() &&
+                   attributeStreamStride(vertex_format_) == geometry_pool.attributeStride() &&
+                   "Vertex format doesn't match the pool.");
+            std::vector<uint8_t> positions, attributes;
+            SplitVertexStreams(encoded, vertex_format_, positions, attributes);
+            geometry_range_ = geometry_pool.allocate(
+                positions.data(), vertex_count_, builder.indices.data(), index_count_, attributes.data());
+            return;
+        }
+        assert(vertexStride(vertex_format_) == geometry_pool.vertexStride() &&
+               geometry_pool.attributeStride() == 0 && "Vertex format doesn't match the pool.");
+        geometry_range_ = geometry_pool.allocate(
+            encoded.data(), vertex_count_, builder.indices.data(), index_count_);
     }
 
     LveModel::~LveModel() {
-        // Alloc Callback field can be fed a allocator struct to help manage the memory.
-        // for alloc, free, and realloc.
-        // For now using nullptr, and managing Vkbuffer and Vkmemory manually.
+        if (geometry_pool_ != nullptr) {
+            geometry_pool_->free(geometry_range_);
+            return;
+        }
         // Problem: There exist hard limit to number of active allocation(~1000) different for different GPUs.
-        // Solution: Allocate bigger chunks of memory and assign different regions to different resources.
-        vkDestroyBuffer(lve_device_.device(), vertex_buffer_, /*alloc callback*/ nullptr);
-        vkFreeMemory(lve_device_.device(), vertex_buffer_memory_, /*alloc callback*/ nullptr);
+        // Solution: LveAllocator allocates bigger chunks of memory and assign different regions to
+        // different resources, destroyBuffer hands our region back to it.
+        // A copy may still be writing the buffers when the model is dropped right after creation.
+        if (upload_ticket_ != 0) {
+            lve_device_.uploadContext().wait(upload_ticket_);
+        }
+        lve_device_.destroyBuffer(vertex_buffer_, vertex_buffer_allocation_);
+        if (attribute_buffer_ != VK_NULL_HANDLE) {
+            lve_device_.destroyBuffer(attribute_buffer_, attribute_buffer_allocation_);
+        }
+        if (index_buffer_ != VK_NULL_HANDLE) {
+            lve_device_.destroyBuffer(index_buffer_, index_buffer_allocation_);
+        }
     }
 
-    void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
+    void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices, MemoryUsage memory_usage) {
         vertex_count_ = vertices.size();
         assert(vertex_count_ >= 3 && "Vertex count must at least be 3 to form a triangle.");
-        VkDeviceSize buffer_size = vertex_count_ * sizeof(vertices[0]);
-        // VK_BUFFER_USAGE_VERTEX_BUFFER_BIT => Using data for vertex shader input.
+        std::vector<uint8_t> encoded = EncodeVertices(vertices, vertex_format_);
+        if (vertex_streams_ == VertexStreams::kSplit) {
+            std::vector<uint8_t> positions, attributes;
+            SplitVertexStreams(encoded, vertex_format_, positions, attributes);
+            createBufferWithData(positions.data(),
+                                 positions.size(),
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                 memory_usage,
+                                 vertex_buffer_,
+                                 vertex_buffer_allocation_);
+            createBufferWithData(attributes.data(),
+                                 attributes.size(),
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                 memory_usage,
+                                 attribute_buffer_,
+                                 attribute_buffer_allocation_);
+            return;
+        }
         // VK_BUFFER_USAGE_VERTEX_BUFFER_BIT => Using data for vertex shader input.
+        createBufferWithData(encoded.data(),
+                             encoded.size(),
+                             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                             memory_usage,
+                             vertex_buffer_,
+                             vertex_buffer_allocation_);
+    }
+
+    void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices, MemoryUsage memory_usage) {
+        index_count_ = static_cast<uint32_t>(indices.size());
+        assert(index_count_ >= 3 && "Index count must at least be 3 to form a triangle.");
+        // Half the index memory and bandwidth whenever the vertices fit. 0xFFFF is left out, it's
+        // the primitive restart index.
+        if (vertex_count_ < 0xFFFF) {
+            index_type_ = VK_INDEX_TYPE_UINT16;
+            std::vector<uint16_t> indices16(indices.begin(), indices.end());
+            createBufferWithData(indices16.data(),
+                                 indices16.size() * sizeof(uint16_t),
+                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                 memory_usage,
+                                 index_buffer_,
+                                 index_buffer_allocation_);
+            return;
+        }
+        index_type_ = VK_INDEX_TYPE_UINT32;
+        createBufferWithData(indices.data(),
+                             indices.size() * sizeof(uint32_t),
+                             VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                             memory_usage,
+                             index_buffer_,
+                             index_buffer_allocation_);
+    }
+
+    void LveModel::createBufferWithData(const void *data,
+                                        VkDeviceSize size,
+                                        VkBufferUsageFlags usage,
+                                        MemoryUsage memory_usage,
+                                        VkBuffer &buffer,
+                                        LveAllocation &allocation) {
         // VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT => want allocated memory to be accesible from host.
         // S.T Host can write to device memory.
         // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT => Automatically sync data in host memory and device memory. i.e no need to memcpy,
         // or to 'VkFlush', it automatically does it for you.
+        // VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT => VRAM on discrete GPUs, vertex fetch doesn't cross PCIe
+        // every frame.
+        VkMemoryPropertyFlags host_visible =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        bool is_direct_write = memory_usage == MemoryUsage::kStreaming ||
+                               lve_device_.allocator().hasLargeHostVisibleDeviceLocalMemory();
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if (memory_usage == MemoryUsage::kStreaming) {
+            properties = host_visible;
+        } else if (is_direct_write) {
+            properties |= host_visible;
+        }
         lve_device_.createBuffer(
-            buffer_size,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            vertex_buffer_,
-            vertex_buffer_memory_
+            size,
+            usage | (is_direct_write ? 0 : VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+            properties,
+            buffer,
+            allocation
         );
-        void *data;
-        vkMapMemory(lve_device_.device(), vertex_buffer_memory_, 0, buffer_size, 0, &data);
-        memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-        vkUnmapMemory(lve_device_.device(), vertex_buffer_memory_);
+        if (is_direct_write) {
+            // Host visible memory blocks are persistently mapped by the allocator,
+            // so no vkMapMemory/vkUnmapMemory needed.
+            memcpy(allocation.mapped, data, static_cast<size_t>(size));
+            return;
+        }
+        // Staged and batched with the other uploads, bind submits it. Tickets only grow, so the
+        // last one covers the earlier copies too.
+        upload_ticket_ = lve_device_.uploadContext().uploadBuffer(buffer, /*dst_offset*/ 0, data, size);
+    }
+
+    void LveModel::writeVertices(const std::vector<Vertex> &vertices) {
+        assert(vertex_buffer_allocation_.mapped != nullptr && "Only host visible models can be rewritten.");
+        assert(vertex_format_ == VertexFormat::kFloat32 && vertex_streams_ == VertexStreams::kInterleaved &&
+               "Only interleaved float models can be rewritten.");
+        assert(vertices.size() == vertex_count_ && "Vertex count can't change.");
+        memcpy(vertex_buffer_allocation_.mapped, vertices.data(), vertices.size() * sizeof(vertices[0]));
+    }
+
+    void LveModel::SubmitUpload() {
+        if (upload_ticket_ != 0) {
+            lve_device_.uploadContext().submit(upload_ticket_);
+            if (lve_device_.uploadContext().isComplete(upload_ticket_)) {
+                upload_ticket_ = 0;
+            }
+        }
     }
 
     void LveModel::bind(VkCommandBuffer command_buffer){
-        VkBuffer buffers[] = {vertex_buffer_};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(command_buffer,/*firstBinding*/ 0, /*bindingCount*/ 1, buffers, offsets);
+        if (geometry_pool_ != nullptr) {
+            geometry_pool_->bind(command_buffer);
+            return;
+        }
+        SubmitUpload();
+        VkBuffer buffers[] = {vertex_buffer_, attribute_buffer_};
+        VkDeviceSize offsets[] = {0, 0};
+        uint32_t binding_count = attribute_buffer_ != VK_NULL_HANDLE ? 2 : 1;
+        vkCmdBindVertexBuffers(command_buffer,/*firstBinding*/ 0, binding_count, buffers, offsets);
+        if (index_buffer_ != VK_NULL_HANDLE) {
+            vkCmdBindIndexBuffer(command_buffer, index_buffer_, /*offset*/ 0, index_type_);
+        }
+    }
+
+    void LveModel::bindPositions(VkCommandBuffer command_buffer){
+        if (geometry_pool_ != nullptr) {
+            geometry_pool_->bindPositions(command_buffer);
+            return;
+        }
+        SubmitUpload();
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(command_buffer,/*firstBinding*/ 0, /*bindingCount*/ 1, &vertex_buffer_, &offset);
+        if (index_buffer_ != VK_NULL_HANDLE) {
+            vkCmdBindIndexBuffer(command_buffer, index_buffer_, /*offset*/ 0, index_type_);
+        }
     }
 
     void LveModel::draw(VkCommandBuffer command_buffer){
+        if (geometry_pool_ != nullptr) {
+            geometry_pool_->draw(command_buffer, geometry_range_);
+            return;
+        }
+        if (index_buffer_ != VK_NULL_HANDLE) {
+            vkCmdDrawIndexed(command_buffer, index_count_, /*num_of_instance*/ 1, /*first_index*/ 0,
+                             /*vertex_offset*/ 0, /*first_instance*/ 0);
+            return;
+        }
         vkCmdDraw(command_buffer, vertex_count_, /*num_of_instance*/ 1, /*first_vertex*/ 0, /*first_instance*/ 0);
     }
 
-    std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions() {
-        std::vector<VkVertexInputBindingDescription> binding_description(1);
-        // binding_id being used.
-        binding_description[0].binding = 0;
-        binding_description[0].stride = sizeof(Vertex);
-        // specifying whether vertex attribute addressing is a function of the vertex index or of the instance index.
-        binding_description[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return binding_description;
+    namespace {
+        // Calls function with the compile time layouts(one per binding) of format and streams.
+        template <typename Function>
+        auto VisitVertexLayouts(VertexFormat format, VertexStreams streams, Function function) {
+            if (streams == VertexStreams::kSplit) {
+                switch (format) {
+                    case VertexFormat::kSnorm16:
+                        return function(kPackedPositionStream2DLayout, kPackedAttributeStream2DLayout);
+                    case VertexFormat::kHalf:
+                        return function(kHalfPositionStream2DLayout, kPackedAttributeStream2DLayout);
+                    case VertexFormat::kFloat32:
+                        break;
+                }
+                return function(kPositionStream2DLayout, kAttributeStream2DLayout);
+            }
+            switch (format) {
+                case VertexFormat::kSnorm16:
+                    // Shader reads vec3, alpha is dropped.
+                    return function(kPackedVertex2DLayout);
+                case VertexFormat::kHalf:
+                    return function(kHalfVertex2DLayout);
+                case VertexFormat::kFloat32:
+                    break;
+            }
+            return function(kModelVertexLayout);
+        }
     }
-    std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions() {
-        std::vector<VkVertexInputAttributeDescription> attribute_description(2);
-        attribute_description[0].location = 0;
-        attribute_description[0].binding = 0;
-        attribute_description[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attribute_description[0].offset = offsetof(Vertex, position_);
 
-        attribute_description[1].location = 1;
-        attribute_description[1].binding = 0;
-        attribute_description[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        // offsetof is a C++ macro to obtain offset from struct.
-        attribute_description[1].offset = offsetof(Vertex, color_);
-        return attribute_description;
+    std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions(
+        VertexFormat format, VertexStreams streams) {
+        return VisitVertexLayouts(format, streams, [](const auto &...layouts) {
+            return vertexBindingDescriptions(layouts...);
+        });
+    }
+    std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions(
+        VertexFormat format, VertexStreams streams) {
+        // The layouts are computed at compile time, only the copy into the vector happens here.
+        return VisitVertexLayouts(format, streams, [](const auto &...layouts) {
+            return vertexAttributeDescriptions(layouts...);
+        });
     }
 
+    std::vector<uint8_t> LveModel::EncodeVertices(const std::vector<Vertex> &vertices, VertexFormat format) {
+        std::vector<uint8_t> encoded(vertices.size() * vertexStride(format));
+        if (format == VertexFormat::kFloat32) {
+            memcpy(encoded.data(), vertices.data(), encoded.size());
+            return encoded;
+        }
+        // Components are gathered into flat arrays so the encoders convert them in SIMD batches.
+        std::vector<float> positions(vertices.size() * 2);
+        std::vector<float> colors(vertices.size() * 4);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[2 * i] = vertices[i].position_.x;
+            positions[2 * i + 1] = vertices[i].position_.y;
+            colors[4 * i] = vertices[i].color_.r;
+            colors[4 * i + 1] = vertices[i].color_.g;
+            colors[4 * i + 2] = vertices[i].color_.b;
+            colors[4 * i + 3] = 1.0f;
+        }
+        std::vector<Unorm8x4> packed_colors(vertices.size());
+        packUnorm8(colors.data(), colors.size(), &packed_colors[0].r);
+        if (format == VertexFormat::kSnorm16) {
+            std::vector<Snorm16x2> packed_positions(vertices.size());
+            packSnorm16(positions.data(), positions.size(), &packed_positions[0].x);
+            auto *out = reinterpret_cast<PackedVertex2D *>(encoded.data());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                out[i] = {packed_positions[i], packed_colors[i]};
+            }
+        } else {
+            std::vector<Half2> packed_positions(vertices.size());
+            packHalf(positions.data(), positions.size(), &packed_positions[0].x);
+            auto *out = reinterpret_cast<HalfVertex2D *>(encoded.data());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                out[i] = {packed_positions[i], packed_colors[i]};
+            }
+        }
+        return encoded;
+    }
+
+    void LveModel::SplitVertexStreams(const std::vector<uint8_t> &interleaved,
+                                      VertexFormat format,
+                                      std::vector<uint8_t> &positions,
+                                      std::vector<uint8_t> &attributes) {
+        // Every interleaved vertex is its position followed by its attributes, without padding.
+        const size_t stride = vertexStride(format);
+        const size_t position_stride = positionStreamStride(format);
+        const size_t attribute_stride = stride - position_stride;
+        const size_t vertex_count = interleaved.size() / stride;
+        positions.resize(vertex_count * position_stride);
+        attributes.resize(vertex_count * attribute_stride);
+        for (size_t i = 0; i < vertex_count; i++) {
+            const uint8_t *vertex = interleaved.data() + i * stride;
+            memcpy(&positions[i * position_stride], vertex, position_stride);
+            memcpy(&attributes[i * attribute_stride], vertex + position_stride, attribute_stride);
+        }
+    }
 
 }
\ No newline at end of file
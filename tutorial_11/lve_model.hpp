@@ -1,6 +1,9 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include "lve_vertex_layout.hpp"
 
 // To ensure it's in radians not in degrees.
 #define GLM_FORCE_RADIANS
@@ -10,7 +13,15 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std lib headers
+#include <unordered_map>
+#include <vector>
+
 namespace lve {
+    template <> struct VertexAttributeFormat<glm::vec2> : VertexAttributeFormatIs<VK_FORMAT_R32G32_SFLOAT> {};
+    template <> struct VertexAttributeFormat<glm::vec3> : VertexAttributeFormatIs<VK_FORMAT_R32G32B32_SFLOAT> {};
+    template <> struct VertexAttributeFormat<glm::vec4> : VertexAttributeFormatIs<VK_FORMAT_R32G32B32A32_SFLOAT> {};
+
     // This class is utilized to take vertex data created by
     // or read from a file on the cpu. Then allocate + copy data into device GPU.
     class LveModel {
@@ -19,29 +30,140 @@ namespace lve {
                 glm::vec2 position_;
                 glm::vec3 color_;
 
-                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+                // Layout of the vertex buffers of models encoded as format and streams.
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(
+                    VertexFormat format = VertexFormat::kFloat32,
+                    VertexStreams streams = VertexStreams::kInterleaved);
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(
+                    VertexFormat format = VertexFormat::kFloat32,
+                    VertexStreams streams = VertexStreams::kInterleaved);
+
+                bool operator==(const Vertex &other) const {
+                    return position_ == other.position_ && color_ == other.color_;
+                }
+                struct Hash {
+                    size_t operator()(const Vertex &vertex) const;
+                };
+            };
+            // Indexed mesh data. addVertex welds vertices equal in every attribute, so corners
+            // shared by several triangles are stored and shaded once(post-transform cache).
+            struct Builder {
+                std::vector<Vertex> vertices{};
+                std::vector<uint32_t> indices{};
+                // What the vertices are encoded to on upload, packed formats are 8 instead of 20 bytes.
+                VertexFormat vertexFormat = VertexFormat::kFloat32;
+                // kSplit puts positions and colors in separate buffers, see VertexStreams.
+                VertexStreams vertexStreams = VertexStreams::kInterleaved;
+
+                // Appends the index of vertex, adding it only if no equal vertex was added before.
+                void addVertex(const Vertex &vertex);
+                // Every 3 vertices are a triangle, e.g the output of generateSierpinskiVertices.
+                void addTriangleList(const std::vector<Vertex> &triangle_list);
+                // Reorders the triangles for the post-transform cache and overdraw, then the
+                // vertices in first use order(see lve_mesh_optimizer.hpp). Call once all
+                // vertices are added, the mesh looks the same.
+                MeshOptimizationReport optimize();
+
+               private:
+                std::unordered_map<Vertex, uint32_t, Vertex::Hash> vertex_indices_{};
             };
-            LveModel(LveDevice &device, const std::vector<Vertex> &vertices);
+            // Where the vertex buffer lives.
+            enum class MemoryUsage {
+                // Written once. DEVICE_LOCAL memory, filled directly when it's host visible
+                // (resizable BAR, integrated GPUs), through the upload context otherwise.
+                kStatic,
+                // Rewritten by the CPU(writeVertices), HOST_VISIBLE memory read over the bus.
+                kStreaming,
+            };
+            // Indexed draw, 16 bit indices when the vertex count allows it.
+            LveModel(LveDevice &device,
+                     const Builder &builder,
+                     MemoryUsage memory_usage = MemoryUsage::kStatic);
+            // Triangle list. kStatic models are welded through Builder, kStreaming ones keep the
+            // vertices as given(non-indexed) so writeVertices can rewrite them in place.
+            LveModel(LveDevice &device,
+                     const std::vector<Vertex> &vertices,
+                     MemoryUsage memory_usage = MemoryUsage::kStatic);
+            // Triangle list of vertex_count vertices written on the GPU before each draw, e.g by
+            // SimpleComputeSystem. Nothing is uploaded, vertexBuffer() is also a storage buffer.
+            LveModel(LveDevice &device, uint32_t vertex_count, VertexFormat vertex_format);
+            // Model stored in a range of geometry_pool instead of buffers of its own, the pool has
+            // to outlive it. Models of the same pool share one bind. The range is freed through the
+            // pool's deferRelease hook, so frames in flight can still draw the dropped model.
+            LveModel(LveDevice &device, LveGeometryPool &geometry_pool, const Builder &builder);
             ~LveModel();
             // Need to remove copy constructor because
             // LveModel manages vulkan buffers and memory objects.
             LveModel(const LveModel &) = delete;
             LveModel &operator=(const LveModel &) = delete;
 
-            // Binds vertex buffer/input data to command_buffer.
+            // Binds vertex buffer/input data to command_buffer. Submits the pending upload first,
+            // without waiting for it, the GPU orders the draw after the copy.
             void bind(VkCommandBuffer command_buffer);
+            // Binds only binding 0 and the index buffer, for depth-only passes. With kSplit streams
+            // that's just the positions, pipelines use e.g kPackedPositionStream2DLayout.
+            void bindPositions(VkCommandBuffer command_buffer);
+            // kStreaming models only, same vertex count. No frame in flight may still read the
+            // buffer, callers double buffer or wait(see LveRenderer::deferRelease).
+            void writeVertices(const std::vector<Vertex> &vertices);
+            // nullptr when the model has buffers of its own.
+            LveGeometryPool *geometryPool() const { return geometry_pool_; }
+            // Binding 0 of models with buffers of their own.
+            VkBuffer vertexBuffer() const { return vertex_buffer_; }
+            uint32_t vertexCount() const { return vertex_count_; }
+            VertexFormat vertexFormat() const { return vertex_format_; }
             // Call commandbuffer to draw.
             void draw(VkCommandBuffer command_buffer);
         private:
             // Allocate memory and buffer in CPU+Device + set data to the given input.
-            void createVertexBuffers(const std::vector<Vertex> &vertices);
+            void createVertexBuffers(const std::vector<Vertex> &vertices, MemoryUsage memory_usage);
+            void createIndexBuffers(const std::vector<uint32_t> &indices, MemoryUsage memory_usage);
+            static std::vector<uint8_t> EncodeVertices(const std::vector<Vertex> &vertices, VertexFormat format);
+            // Cuts interleaved vertices of format after the position, into the two kSplit streams.
+            static void SplitVertexStreams(const std::vector<uint8_t> &interleaved,
+                                           VertexFormat format,
+                                           std::vector<uint8_t> &positions,
+                                           std::vector<uint8_t> &attributes);
+            // Submits the pending upload without waiting for it.
+            void SubmitUpload();
+            // Buffer in the memory memory_usage asks for, filled with data.
+            void createBufferWithData(const void *data,
+                                      VkDeviceSize size,
+                                      VkBufferUsageFlags usage,
+                                      MemoryUsage memory_usage,
+                                      VkBuffer &buffer,
+                                      LveAllocation &allocation);
             LveDevice &lve_device_;
             // In Vulkan, buffer and assigned memory are separate.
             // contrast to memory being allocated automatically assigned for buffer.
             // gives programmer more control for memory management.
             VkBuffer vertex_buffer_;
-            VkDeviceMemory vertex_buffer_memory_;
+            // Region of a bigger memory block owned by the device's LveAllocator.
+            LveAllocation vertex_buffer_allocation_;
+            VertexFormat vertex_format_ = VertexFormat::kFloat32;
+            VertexStreams vertex_streams_ = VertexStreams::kInterleaved;
+            // Binding 1 of kSplit models, vertex_buffer_ only holds the positions then.
+            VkBuffer attribute_buffer_ = VK_NULL_HANDLE;
+            LveAllocation attribute_buffer_allocation_;
             uint32_t vertex_count_;
+            // Non-indexed models have no index buffer, draw falls back to vkCmdDraw.
+            VkBuffer index_buffer_ = VK_NULL_HANDLE;
+            LveAllocation index_buffer_allocation_;
+            uint32_t index_count_ = 0;
+            VkIndexType index_type_ = VK_INDEX_TYPE_UINT32;
+            // Set instead of the buffers above for models living in a geometry pool.
+            LveGeometryPool *geometry_pool_ = nullptr;
+            GeometryRange geometry_range_{};
+            // Copies into the buffers still to be submitted or finished, 0 when there's none.
+            UploadTicket upload_ticket_ = 0;
     };
+
+    // Layout of LveModel::Vertex(VertexFormat::kFloat32), the packed ones are in lve_vertex_layout.hpp.
+    inline constexpr auto kModelVertexLayout = makeVertexLayout<LveModel::Vertex>(
+        /*binding*/ 0,
+        /*first_location*/ 0,
+        LVE_VERTEX_FIELD(LveModel::Vertex, position_),
+        LVE_VERTEX_FIELD(LveModel::Vertex, color_));
+    static_assert(vertexStride(VertexFormat::kFloat32) == kModelVertexLayout.binding.stride,
+                  "kFloat32 stride doesn't match LveModel::Vertex.");
 }
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "lve_offscreen_renderer.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace lve {
+
+LveOffscreenRenderer::LveOffscreenRenderer(LveDevice &device, VkExtent2D extent, uint32_t frames_in_flight)
+    : lve_device_(device), extent_(extent), frames_in_flight_(frames_in_flight) {
+  assert(frames_in_flight > 0 && "Need at least one frame in flight.");
+  depth_format_ = FindDepthFormat();
+  CreateRenderPass();
+  CreateFrames();
+}
+
+LveOffscreenRenderer::~LveOffscreenRenderer() {
+  DestroyFrames();
+  vkDestroyRenderPass(lve_device_.device(), render_pass_, nullptr);
+}
+
+void LveOffscreenRenderer::DestroyFrames() {
+  for (auto &frame : frames_) {
+    vkWaitForFences(lve_device_.device(), 1, &frame.in_flight_fence, VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+    vkDestroyFence(lve_device_.device(), frame.in_flight_fence, nullptr);
+    vkFreeCommandBuffers(lve_device_.device(), lve_device_.getCommandPool(), 1, &frame.command_buffer);
+    vkFreeCommandBuffers(
+        lve_device_.device(), lve_device_.getComputeCommandPool(), 1, &frame.compute_command_buffer);
+    vkDestroySemaphore(lve_device_.device(), frame.compute_finished_semaphore, nullptr);
+    vkDestroyFramebuffer(lve_device_.device(), frame.framebuffer, nullptr);
+    vkDestroyImageView(lve_device_.device(), frame.color_view, nullptr);
+    lve_device_.destroyImage(frame.color_image, frame.color_allocation);
+    vkDestroyImageView(lve_device_.device(), frame.depth_view, nullptr);
+    lve_device_.destroyImage(frame.depth_image, frame.depth_allocation);
+  }
+  frames_.clear();
+}
+
+void LveOffscreenRenderer::setFramesInFlight(uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "Need at least one frame in flight.");
+  frames_in_flight_ = frames_in_flight;
+}
+
+VkFormat LveOffscreenRenderer::FindDepthFormat() {
+  return lve_device_.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
+
+// Same attachments as LveSwapChain::createRenderPass, except that the color attachment ends up
+// ready to be copied out(TRANSFER_SRC) instead of presented.
+void LveOffscreenRenderer::CreateRenderPass() {
+  VkAttachmentDescription depth_attachment{};
+  depth_attachment.format = depth_format_;
+  depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depth_attachment_ref{};
+  depth_attachment_ref.attachment = 1;
+  depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentDescription color_attachment{};
+  color_attachment.format = kColorFormat;
+  color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  VkAttachmentReference color_attachment_ref{};
+  color_attachment_ref.attachment = 0;
+  color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &color_attachment_ref;
+  subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  // Color writes have to land before the image is copied out in readPixels.
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {color_attachment, depth_attachment};
+  VkRenderPassCreateInfo render_pass_info{};
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+  render_pass_info.pAttachments = attachments.data();
+  render_pass_info.subpassCount = 1;
+  render_pass_info.pSubpasses = &subpass;
+  render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  render_pass_info.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(lve_device_.device(), &render_pass_info, nullptr, &render_pass_) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create offscreen render pass.");
+  }
+}
+
+void LveOffscreenRenderer::CreateImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                       VkImage &image, LveAllocation &allocation, VkImageView &view) {
+  VkImageCreateInfo image_info{};
+  image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  image_info.imageType = VK_IMAGE_TYPE_2D;
+  image_info.extent.width = extent_.width;
+  image_info.extent.height = extent_.height;
+  image_info.extent.depth = 1;
+  image_info.mipLevels = 1;
+  image_info.arrayLayers = 1;
+  image_info.format = format;
+  image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  image_info.usage = usage;
+  image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+  image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  lve_device_.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+
+  VkImageViewCreateInfo view_info{};
+  view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  view_info.image = image;
+  view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  view_info.format = format;
+  view_info.subresourceRange.aspectMask = aspect;
+  view_info.subresourceRange.baseMipLevel = 0;
+  view_info.subresourceRange.levelCount = 1;
+  view_info.subresourceRange.baseArrayLayer = 0;
+  view_info.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(lve_device_.device(), &view_info, nullptr, &view) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create offscreen image view.");
+  }
+}
+
+void LveOffscreenRenderer::CreateFrames() {
+  // One render target per frame in flight, so frame N+1 can be recorded while N is rendering.
+  frames_.resize(frames_in_flight_);
+  for (auto &frame : frames_) {
+    CreateImage(kColorFormat,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                frame.color_image, frame.color_allocation, frame.color_view);
+    CreateImage(depth_format_,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                VK_IMAGE_ASPECT_DEPTH_BIT,
+                frame.depth_image, frame.depth_allocation, frame.depth_view);
+
+    std::array<VkImageView, 2> attachments = {frame.color_view, frame.depth_view};
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = render_pass_;
+    framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebuffer_info.pAttachments = attachments.data();
+    framebuffer_info.width = extent_.width;
+    framebuffer_info.height = extent_.height;
+    framebuffer_info.layers = 1;
+    if (vkCreateFramebuffer(lve_device_.device(), &framebuffer_info, nullptr, &frame.framebuffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create offscreen framebuffer.");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = lve_device_.getCommandPool();
+    alloc_info.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, &frame.command_buffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create command buffer.");
+    }
+    // Has to come from a pool of the family of the queue it is submitted to.
+    alloc_info.commandPool = lve_device_.getComputeCommandPool();
+    if (vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, &frame.compute_command_buffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create compute command buffer.");
+    }
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(lve_device_.device(), &semaphore_info, nullptr, &frame.compute_finished_semaphore) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create compute semaphore.");
+    }
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    // Signaled, so the first beginFrame doesn't wait forever.
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    if (vkCreateFence(lve_device_.device(), &fence_info, nullptr, &frame.in_flight_fence) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create offscreen fence.");
+    }
+  }
+}
+
+VkCommandBuffer LveOffscreenRenderer::beginFrame() {
+  assert(!is_frame_started_ && "Cannot start beginFrame when another frame is already in progess.");
+  // Frame count changed, DestroyFrames waits for every frame still in flight.
+  if (frames_.size() != frames_in_flight_) {
+    DestroyFrames();
+    CreateFrames();
+    current_frame_idx_ = 0;
+    last_submitted_frame_idx_ = -1;
+  }
+  auto &frame = frames_[current_frame_idx_];
+  // No image to acquire, only wait until the GPU is done with this frame's resources.
+  vkWaitForFences(lve_device_.device(), 1, &frame.in_flight_fence, VK_TRUE,
+                  std::numeric_limits<uint64_t>::max());
+
+  is_frame_started_ = true;
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  if (vkBeginCommandBuffer(frame.command_buffer, &begin_info) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin recording command buffer.");
+  }
+  return frame.command_buffer;
+}
+
+void LveOffscreenRenderer::endFrame() {
+  assert(is_frame_started_ && "Cannot get cmd_buffer when frame is not in process.");
+  auto &frame = frames_[current_frame_idx_];
+  if (vkEndCommandBuffer(frame.command_buffer) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to end recording command buffer.");
+  }
+
+  assert(!is_compute_started_ && "Cannot end frame while compute command buffer is still recording.");
+
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.waitSemaphoreCount = static_cast<uint32_t>(frame_wait_semaphores_.size());
+  submit_info.pWaitSemaphores = frame_wait_semaphores_.data();
+  submit_info.pWaitDstStageMask = frame_wait_stages_.data();
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &frame.command_buffer;
+  vkResetFences(lve_device_.device(), 1, &frame.in_flight_fence);
+  if (vkQueueSubmit(lve_device_.graphicsQueue(), 1, &submit_info, frame.in_flight_fence) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit draw command buffer.");
+  }
+  frame_wait_semaphores_.clear();
+  frame_wait_stages_.clear();
+
+  is_frame_started_ = false;
+  last_submitted_frame_idx_ = current_frame_idx_;
+  current_frame_idx_ = (current_frame_idx_ + 1) % frames_in_flight_;
+}
+
+VkCommandBuffer LveOffscreenRenderer::beginCompute() {
+  assert(is_frame_started_ && "Cannot begin compute when frame is not in process.");
+  assert(!is_compute_started_ && "Compute command buffer of this frame is already recording.");
+  // Safe to reset, the frame fence waited in beginFrame covers the last use of this buffer.
+  auto compute_command_buffer = frames_[current_frame_idx_].compute_command_buffer;
+  vkResetCommandBuffer(compute_command_buffer, 0);
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(compute_command_buffer, &begin_info) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin recording compute command buffer.");
+  }
+  is_compute_started_ = true;
+  return compute_command_buffer;
+}
+
+void LveOffscreenRenderer::endCompute(VkCommandBuffer compute_command_buffer, VkPipelineStageFlags wait_stage) {
+  assert(is_compute_started_ && "Cannot end compute that was not started.");
+  auto &frame = frames_[current_frame_idx_];
+  assert(compute_command_buffer == frame.compute_command_buffer &&
+         "Cannot end compute command buffer from different frame.");
+  if (vkEndCommandBuffer(compute_command_buffer) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to end recording compute command buffer.");
+  }
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &compute_command_buffer;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &frame.compute_finished_semaphore;
+  if (vkQueueSubmit(lve_device_.computeQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit compute command buffer.");
+  }
+  is_compute_started_ = false;
+  addWaitSemaphore(frame.compute_finished_semaphore, wait_stage);
+}
+
+void LveOffscreenRenderer::addWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags wait_stage) {
+  assert(is_frame_started_ && "Cannot add wait semaphore when frame is not in process.");
+  frame_wait_semaphores_.push_back(semaphore);
+  frame_wait_stages_.push_back(wait_stage);
+}
+
+void LveOffscreenRenderer::beginRenderPass(VkCommandBuffer command_buffer) {
+  assert(is_frame_started_ && "Cannot get cmd_buffer when frame is not in process.");
+  assert(command_buffer == getCurrentCommandBuffer() && "Cannot start render pass on command buffer from different frame.");
+  VkRenderPassBeginInfo render_pass_info{};
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  render_pass_info.renderPass = render_pass_;
+  render_pass_info.framebuffer = frames_[current_frame_idx_].framebuffer;
+  render_pass_info.renderArea.offset = {0, 0};
+  render_pass_info.renderArea.extent = extent_;
+
+  // Same clear values as the on screen renderer, so golden images match what's displayed.
+  std::array<VkClearValue, 2> clear_values{};
+  clear_values[0].color = {0.1f, 0.1f, 0.1f, 0.1f};
+  clear_values[1].depthStencil = {1.0f, 0};
+  render_pass_info.clearValueCount = clear_values.size();
+  render_pass_info.pClearValues = clear_values.data();
+  vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(extent_.width);
+  viewport.height = static_cast<float>(extent_.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, extent_};
+  vkCmdSetViewport(command_buffer, /*first viewport*/ 0, /*viewport count*/ 1, &viewport);
+  vkCmdSetScissor(command_buffer, /*first scissor*/ 0, /*scissor count*/ 1, &scissor);
+}
+
+void LveOffscreenRenderer::endRenderPass(VkCommandBuffer command_buffer) {
+  assert(is_frame_started_ && "Cannot get cmd_buffer when frame is not in process.");
+  assert(command_buffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from different frame.");
+  vkCmdEndRenderPass(command_buffer);
+}
+
+std::vector<uint8_t> LveOffscreenRenderer::readPixels() {
+  assert(!is_frame_started_ && "Cannot read pixels while a frame is in progress.");
+  assert(last_submitted_frame_idx_ >= 0 && "No frame rendered yet.");
+  auto &frame = frames_[last_submitted_frame_idx_];
+  vkWaitForFences(lve_device_.device(), 1, &frame.in_flight_fence, VK_TRUE,
+                  std::numeric_limits<uint64_t>::max());
+
+  VkDeviceSize size = static_cast<VkDeviceSize>(extent_.width) * extent_.height * 4;
+  VkBuffer readback_buffer;
+  LveAllocation readback_allocation;
+  lve_device_.createBuffer(
+      size,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      readback_buffer,
+      readback_allocation);
+
+  // One-off blocking copy, readback is for tests and captures, not for the frame loop.
+  VkCommandBuffer command_buffer = lve_device_.beginSingleTimeCommands();
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {extent_.width, extent_.height, 1};
+  vkCmdCopyImageToBuffer(command_buffer, frame.color_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readback_buffer, 1, &region);
+  // Make the transfer write visible to the host read below.
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+  lve_device_.endSingleTimeCommands(command_buffer);
+
+  std::vector<uint8_t> pixels(static_cast<size_t>(size));
+  memcpy(pixels.data(), readback_allocation.mapped, pixels.size());
+  lve_device_.destroyBuffer(readback_buffer, readback_allocation);
+  return pixels;
+}
+
+void LveOffscreenRenderer::writePpm(const std::string &file_path) {
+  auto pixels = readPixels();
+  std::ofstream file{file_path, std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file " + file_path);
+  }
+  file << "P6\n" << extent_.width << " " << extent_.height << "\n255\n";
+  // BGRA -> RGB.
+  for (size_t i = 0; i < pixels.size(); i += 4) {
+    char rgb[3] = {static_cast<char>(pixels[i + 2]), static_cast<char>(pixels[i + 1]),
+                   static_cast<char>(pixels[i])};
+    file.write(rgb, 3);
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace lve {
+// Renderer without swap chain. Renders into color+depth images owned by the renderer, so it works
+// with a headless LveDevice(no window/surface). Same frame API as LveRenderer, render systems
+// only see a command buffer and a render pass, so they work with both.
+// The render pass uses the same formats as the swap chain's, pipelines can be shared between them.
+class LveOffscreenRenderer {
+  public:
+    static constexpr VkFormat kColorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+
+    LveOffscreenRenderer(LveDevice &device, VkExtent2D extent, uint32_t frames_in_flight = 2);
+    ~LveOffscreenRenderer();
+    LveOffscreenRenderer(const LveOffscreenRenderer &) = delete;
+    LveOffscreenRenderer &operator=(const LveOffscreenRenderer &) = delete;
+
+    // Starts a command frame to start recording
+    VkCommandBuffer beginFrame();
+    // end the command frame recording and submit it.
+    void endFrame();
+
+    // Same as LveRenderer::beginCompute/endCompute/addWaitSemaphore: compute work of the current
+    // frame on the compute queue, the frame's graphics submission waits for it at wait_stage.
+    VkCommandBuffer beginCompute();
+    void endCompute(VkCommandBuffer compute_command_buffer, VkPipelineStageFlags wait_stage);
+    void addWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags wait_stage);
+
+    void beginRenderPass(VkCommandBuffer command_buffer);
+    void endRenderPass(VkCommandBuffer command_buffer);
+
+    // Same as LveRenderer::setFramesInFlight, takes effect at the start of the next frame.
+    void setFramesInFlight(uint32_t frames_in_flight);
+    uint32_t getFramesInFlight() const { return frames_in_flight_; }
+
+    VkRenderPass getRenderPass() const { return render_pass_; }
+    VkExtent2D getExtent() const { return extent_; }
+    RenderPassCompatibility getRenderPassCompatibility() const {
+      return {kColorFormat, depth_format_, VK_SAMPLE_COUNT_1_BIT};
+    }
+
+    bool isFrameInProgess() const {
+      return is_frame_started_;
+    }
+
+    int getFrameIndex() {
+      assert(is_frame_started_ && "Cannot get frame index when frame is not in process");
+      return current_frame_idx_;
+    }
+
+    VkCommandBuffer getCurrentCommandBuffer() const {
+      assert(is_frame_started_ && "Cannot get cmd_buffer when frame is not in process");
+      return frames_[current_frame_idx_].command_buffer;
+    }
+
+    // Waits for the last submitted frame and copies its color image to the host.
+    // Tightly packed BGRA8 rows, width * height * 4 bytes. Used for golden image comparisons.
+    std::vector<uint8_t> readPixels();
+    // Writes readPixels() as a binary PPM(P6) file.
+    void writePpm(const std::string &file_path);
+
+  private:
+    struct Frame {
+      VkImage color_image;
+      LveAllocation color_allocation;
+      VkImageView color_view;
+      VkImage depth_image;
+      LveAllocation depth_allocation;
+      VkImageView depth_view;
+      VkFramebuffer framebuffer;
+      VkCommandBuffer command_buffer;
+      VkFence in_flight_fence;
+      // From the compute pool. Safe to reuse once in_flight_fence signaled, the graphics
+      // submission waited on compute_finished_semaphore.
+      VkCommandBuffer compute_command_buffer;
+      VkSemaphore compute_finished_semaphore;
+    };
+
+    void CreateRenderPass();
+    void CreateFrames();
+    void DestroyFrames();
+    void CreateImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                     VkImage &image, LveAllocation &allocation, VkImageView &view);
+    VkFormat FindDepthFormat();
+
+    LveDevice& lve_device_;
+    VkExtent2D extent_;
+    VkFormat depth_format_;
+    VkRenderPass render_pass_;
+    std::vector<Frame> frames_;
+    uint32_t frames_in_flight_;
+
+    std::vector<VkSemaphore> frame_wait_semaphores_;
+    std::vector<VkPipelineStageFlags> frame_wait_stages_;
+    bool is_compute_started_{false};
+
+    int current_frame_idx_{0};
+    int last_submitted_frame_idx_{-1};
+    bool is_frame_started_{false};
+};
+
+}  // namespace lve
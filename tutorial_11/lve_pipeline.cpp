@@ -1,76 +1,66 @@
 #include "lve_pipeline.hpp"
 #include "lve_model.hpp"
 
-#include <fstream>
 #include <stdexcept>
 #include <iostream>
 
 namespace lve {
-    std::vector<char> LvePipeline::ReadFile(const std::string& file_name) {
 
-        // ios::ate = bit flag to seek end immediately after opening. easier to get size.
-        // ios::binary = bit flag to read as binary. prevents unwanted text/string transform.
-        std::ifstream file{file_name, std::ios::ate | std::ios::binary};
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file" + file_name);
-        }
-        // [tellg] gets position of stream/file/char. Since we start from the end due to ios::ate,
-        // we can use this to get the numel of chars, which is used for initializing buffer.
-        size_t file_size = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(file_size);
-
-        // [seekg] sets position of stream/file to an index. which is 0/start for our use case.
-        // this is used to start reading the data in the file.
-        file.seekg(0);
-        // [read] stores "file_size" amount of data from current stream position into pointer
-        // given by buffer.data().
-        file.read(buffer.data(), file_size);
-        file.close();
-        return buffer;
+    VkSpecializationInfo LvePipeline::MakeSpecializationInfo(const SpecializationConstants& constants) {
+        VkSpecializationInfo specialization_info{};
+        specialization_info.mapEntryCount = static_cast<uint32_t>(constants.mapEntries.size());
+        specialization_info.pMapEntries = constants.mapEntries.data();
+        specialization_info.dataSize = constants.data.size();
+        specialization_info.pData = constants.data.data();
+        return specialization_info;
     }
 
-    void LvePipeline::CreateGraphicPipeline(const std::string& vert_file_path,
-                                            const std::string& frag_file_path,
-                                            const PipelineConfigInfo& config_info) {
-        auto vertCode = ReadFile(vert_file_path);
-        auto fragCode = ReadFile(frag_file_path);
-
-        CreateShaderModule(vertCode, &vert_shader_module_);
-        CreateShaderModule(fragCode, &frag_shader_module_);
-
+    void LvePipeline::CreateGraphicPipeline(const PipelineConfigInfo& config_info) {
         VkPipelineShaderStageCreateInfo shader_stages[2];
         shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        shader_stages[0].module = vert_shader_module_;
+        shader_stages[0].module = vert_shader_module_->module();
         // pName the name to the entry function in shader.
         shader_stages[0].pName = "main";
         // 0 => set no flags.
         shader_stages[0].flags = 0;
         shader_stages[0].pNext = nullptr;
         // Customizes shader functionality.
-        shader_stages[0].pSpecializationInfo = nullptr;
+        VkSpecializationInfo vert_specialization_info = MakeSpecializationInfo(config_info.vertSpecialization);
+        shader_stages[0].pSpecializationInfo =
+            config_info.vertSpecialization.empty() ? nullptr : &vert_specialization_info;
 
         shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        shader_stages[1].module = frag_shader_module_;
+        shader_stages[1].module = frag_shader_module_->module();
         // pName the name to the entry function in shader.
         shader_stages[1].pName = "main";
         // 0 => set no flags.
         shader_stages[1].flags = 0;
         shader_stages[1].pNext = nullptr;
         // Customizes shader functionality.
-        shader_stages[1].pSpecializationInfo = nullptr;
+        VkSpecializationInfo frag_specialization_info = MakeSpecializationInfo(config_info.fragSpecialization);
+        shader_stages[1].pSpecializationInfo =
+            config_info.fragSpecialization.empty() ? nullptr : &frag_specialization_info;
 
         VkPipelineVertexInputStateCreateInfo vertex_input_info{};
         vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         // Setting for supplying data.
-        auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
-        auto bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+        const auto &attributeDescriptions = config_info.attributeDescriptions;
+        const auto &bindingDescriptions = config_info.bindingDescriptions;
         vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
         vertex_input_info.pVertexAttributeDescriptions = attributeDescriptions.data();
         vertex_input_info.pVertexBindingDescriptions = bindingDescriptions.data();
 
+        // config_info points into itself(pAttachments, pDynamicStates). When it was copied, e.g into
+        // LvePipelineCompiler's queue, those still point at the original, so re-point them here.
+        VkPipelineColorBlendStateCreateInfo color_blend_info = config_info.colorBlendInfo;
+        color_blend_info.pAttachments = &config_info.colorBlendAttachment;
+        VkPipelineDynamicStateCreateInfo dynamic_state_info = config_info.dynamicStateInfo;
+        dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config_info.dynamicStateEnables.size());
+        dynamic_state_info.pDynamicStates = config_info.dynamicStateEnables.data();
+
         VkGraphicsPipelineCreateInfo pipeline_info{};
         pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         // stageCount specify how many programmable stage our pipeline uses.
@@ -81,9 +71,10 @@ namespace lve {
         pipeline_info.pInputAssemblyState = &config_info.inputAssemblyInfo;
         pipeline_info.pViewportState = &config_info.viewportInfo;
         pipeline_info.pRasterizationState = &config_info.rasterizationInfo;
-        pipeline_info.pColorBlendState = &config_info.colorBlendInfo;
+        pipeline_info.pMultisampleState = &config_info.multisampleInfo;
+        pipeline_info.pColorBlendState = &color_blend_info;
         pipeline_info.pDepthStencilState = &config_info.depthStencilInfo;
-        pipeline_info.pDynamicState = &config_info.dynamicStateInfo;
+        pipeline_info.pDynamicState = &dynamic_state_info;
 
         pipeline_info.layout = config_info.pipelineLayout;
         pipeline_info.renderPass = config_info.renderPass;
@@ -94,10 +85,25 @@ namespace lve {
         pipeline_info.basePipelineIndex = -1;
         pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-        if(vkCreateGraphicsPipelines(lve_device_.device(), /*pipeline cache*/ VK_NULL_HANDLE, /*pipeline count*/ 1,
+        // Ask the driver whether the pipeline came out of the pipeline cache.
+        VkPipelineCreationFeedbackEXT pipeline_feedback{};
+        VkPipelineCreationFeedbackEXT stage_feedbacks[2]{};
+        VkPipelineCreationFeedbackCreateInfoEXT feedback_info{};
+        feedback_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedback_info.pPipelineCreationFeedback = &pipeline_feedback;
+        feedback_info.pipelineStageCreationFeedbackCount = pipeline_info.stageCount;
+        feedback_info.pPipelineStageCreationFeedbacks = stage_feedbacks;
+        if (lve_device_.hasPipelineCreationFeedback()) {
+            pipeline_info.pNext = &feedback_info;
+        }
+
+        if(vkCreateGraphicsPipelines(lve_device_.device(), lve_device_.pipelineCache(), /*pipeline count*/ 1,
                                     &pipeline_info, /*alloc callback*/ nullptr, &graphics_pipeline_) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create graphics pipeline.");
         }
+        if (lve_device_.hasPipelineCreationFeedback()) {
+            lve_device_.reportPipelineFeedback(pipeline_feedback);
+        }
 
     }
 
@@ -105,12 +111,13 @@ namespace lve {
                 const std::string& vert_file_path,
                 const std::string& frag_file_path,
                 const PipelineConfigInfo& config_info) : lve_device_{device} {
-        CreateGraphicPipeline(vert_file_path, frag_file_path, config_info);
+        // No file I/O or module creation when another pipeline already uses these shaders.
+        vert_shader_module_ = lve_device_.shaderLibrary().load(vert_file_path);
+        frag_shader_module_ = lve_device_.shaderLibrary().load(frag_file_path);
+        CreateGraphicPipeline(config_info);
     }
 
     LvePipeline::~LvePipeline() {
-        vkDestroyShaderModule(lve_device_.device(), vert_shader_module_, nullptr);
-        vkDestroyShaderModule(lve_device_.device(), frag_shader_module_, nullptr);
         vkDestroyPipeline(lve_device_.device(), graphics_pipeline_, nullptr);
     }
 
@@ -125,19 +132,6 @@ namespace lve {
     }
 
 
-    void LvePipeline::CreateShaderModule(const std::vector<char>& code, VkShaderModule* output_module) {
-        VkShaderModuleCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = code.size();
-        // Although uint32_t.size != char.size, since we store code in vector, allocator
-        // already ensure worst case data alignment requriement. Won't work if we use c-style array.
-        create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-        if(vkCreateShaderModule(lve_device_.device(), &create_info, nullptr, output_module) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create shader module.");
-        }
-    }
-
     void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& out_config_info) {
         // Setting up first stage of pipeline/Input Assembler.
         // Takes in list of vertices and group them as geometry.
@@ -235,6 +229,9 @@ namespace lve {
         out_config_info.depthStencilInfo.front = {};  // Optional
         out_config_info.depthStencilInfo.back = {};   // Optional
 
+        // Vertex input stage: how vertex buffers are read into the vertex shader's inputs.
+        out_config_info.setVertexLayout(kModelVertexLayout);
+
         // Configure pipeline to expect dynamic viewport and scissor to be provided later.
         out_config_info.dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
         out_config_info.dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -1,12 +1,86 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_shader_library.hpp"
+#include "lve_vertex_layout.hpp"
+#include <array>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace lve {
+// Converts to any 4 byte type. T{FourByteField, ...} with sizeof(T) / 4 of them only compiles when
+// every field of T is 4 bytes, e.g {uint32_t; bool;} is 8 bytes but its bool isn't.
+struct FourByteField {
+  template <typename U, typename = std::enable_if_t<sizeof(U) == sizeof(uint32_t)>>
+  operator U() const;
+};
+template <typename T, typename Indices, typename = void>
+struct HasOnlyFourByteFields : std::false_type {};
+template <typename T, size_t... kIndices>
+struct HasOnlyFourByteFields<T,
+                             std::index_sequence<kIndices...>,
+                             std::void_t<decltype(T{(static_cast<void>(kIndices), FourByteField{})...})>>
+    : std::true_type {};
+
+// Map entries for a struct of specialization constants, computed at compile time.
+// Every field has to be 4 bytes(uint32_t, int32_t, float, VkBool32 for bool) so the struct has
+// no padding: field i is at offset 4 * i and is bound to `layout(constant_id = i)` in the shader.
+template <typename T>
+constexpr std::array<VkSpecializationMapEntry, sizeof(T) / sizeof(uint32_t)> makeSpecializationMapEntries() {
+  static_assert(std::is_trivially_copyable<T>::value && std::is_standard_layout<T>::value &&
+                    std::is_aggregate<T>::value,
+                "Specialization constants must be a plain struct.");
+  // Padding bytes would otherwise end up in the constants' data.
+  static_assert(sizeof(T) % sizeof(uint32_t) == 0 &&
+                    HasOnlyFourByteFields<T, std::make_index_sequence<sizeof(T) / sizeof(uint32_t)>>::value,
+                "Specialization constants must only have 4 byte fields.");
+  std::array<VkSpecializationMapEntry, sizeof(T) / sizeof(uint32_t)> entries{};
+  for (uint32_t i = 0; i < entries.size(); i++) {
+    entries[i].constantID = i;
+    entries[i].offset = i * static_cast<uint32_t>(sizeof(uint32_t));
+    entries[i].size = sizeof(uint32_t);
+  }
+  return entries;
+}
+
+// Specialization constants of one shader stage. Lets the driver fold branches on them away when
+// compiling the pipeline, instead of paying for uniform reads and branches per vertex/fragment.
+struct SpecializationConstants {
+  std::vector<VkSpecializationMapEntry> mapEntries;
+  std::vector<uint8_t> data;
+
+  template <typename T>
+  void set(const T &constants) {
+    static constexpr auto kEntries = makeSpecializationMapEntries<T>();
+    mapEntries.assign(kEntries.begin(), kEntries.end());
+    data.resize(sizeof(T));
+    memcpy(data.data(), &constants, sizeof(T));
+  }
+  bool empty() const { return mapEntries.empty(); }
+};
+
+// What a graphics pipeline depends on from the render pass it was created with. Render passes with
+// equal attachment formats and sample counts are compatible, so a pipeline created with one can be
+// used with the others, e.g across swap chain recreation on resize.
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/html/chap8.html#renderpass-compatibility
+struct RenderPassCompatibility {
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+  bool operator==(const RenderPassCompatibility &other) const {
+    return colorFormat == other.colorFormat && depthFormat == other.depthFormat && samples == other.samples;
+  }
+  bool operator!=(const RenderPassCompatibility &other) const { return !(*this == other); }
+};
+
 // Not part of LvePipeline class because want application layer to configure pipeline easily, and
-// reuse for multiple pipelines
+// reuse for multiple pipelines. Safe to copy, LvePipeline re-points colorBlendInfo.pAttachments and
+// dynamicStateInfo.pDynamicStates at the copy's own members.
 struct PipelineConfigInfo {
   VkPipelineViewportStateCreateInfo viewportInfo;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
@@ -20,6 +94,20 @@ struct PipelineConfigInfo {
   std::vector<VkDynamicState> dynamicStateEnables;
   VkPipelineDynamicStateCreateInfo dynamicStateInfo;
   uint32_t subpass = 0;
+  // Vertex buffer layout, LveModel::Vertex(float) by default. Set to the layout of the models
+  // drawn, e.g setVertexLayout(kPackedVertex2DLayout).
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+  // Empty = no specialization, the shader's default constant values are used.
+  SpecializationConstants vertSpecialization;
+  SpecializationConstants fragSpecialization;
+
+  // Replaces the vertex input with layouts made by makeVertexLayout, one per vertex buffer binding.
+  template <size_t... kAttributeCounts>
+  void setVertexLayout(const VertexLayout<kAttributeCounts> &...layouts) {
+    bindingDescriptions = vertexBindingDescriptions(layouts...);
+    attributeDescriptions = vertexAttributeDescriptions(layouts...);
+  }
 };
 
 class LvePipeline {
@@ -40,20 +128,17 @@ class LvePipeline {
     void bind(VkCommandBuffer command_buffer);
 
     private:
-    static std::vector<char> ReadFile(const std::string& file_name);
-    void CreateGraphicPipeline(const std::string& vert_file_path,
-                                const std::string& frag_file_path,
-                                const PipelineConfigInfo& config_info);
-
-    // Convert spv code to vkShaderModule.
-    void CreateShaderModule(const std::vector<char>& code, VkShaderModule* output_module);
+    static VkSpecializationInfo MakeSpecializationInfo(const SpecializationConstants& constants);
+    // Expects vert_shader_module_ and frag_shader_module_ to be set.
+    void CreateGraphicPipeline(const PipelineConfigInfo& config_info);
 
     // Storing device reference. Could've been memory unsafe if device was released before pipeline was released.
     // But since we know the implicit relationship that the device will outlive the pipeline, it's unlikely to happen.
     // Also known as aggregation relationship in UML.
     LveDevice& lve_device_;
     VkPipeline graphics_pipeline_;
-    VkShaderModule vert_shader_module_;
-    VkShaderModule frag_shader_module_;
+    // Shared with other pipelines using the same shaders, see LveShaderLibrary.
+    std::shared_ptr<LveShaderModule> vert_shader_module_;
+    std::shared_ptr<LveShaderModule> frag_shader_module_;
 };
 } // namespace lve
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_registry.hpp"
+
+#include <algorithm>
+
+namespace lve {
+
+LvePipelineCompiler::LvePipelineCompiler(LveDevice &device, uint32_t worker_count)
+    : lve_device_{device} {
+  if (worker_count == 0) {
+    // hardware_concurrency may return 0 when unknown.
+    worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+  workers_.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; i++) {
+    workers_.emplace_back(&LvePipelineCompiler::WorkerLoop, this);
+  }
+}
+
+LvePipelineCompiler::~LvePipelineCompiler() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    is_stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+LvePipelineHandle LvePipelineCompiler::compile(GraphicsPipelineDesc desc) {
+  auto handle = Enqueue(std::move(desc));
+  task_available_.notify_one();
+  return handle;
+}
+
+std::vector<LvePipelineHandle> LvePipelineCompiler::compileBatch(std::vector<GraphicsPipelineDesc> descs) {
+  std::vector<LvePipelineHandle> handles;
+  handles.reserve(descs.size());
+  for (auto &desc : descs) {
+    handles.push_back(Enqueue(std::move(desc)));
+  }
+  task_available_.notify_all();
+  return handles;
+}
+
+void LvePipelineCompiler::waitIdle() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  idle_.wait(lock, [this] { return pending_count_ == 0; });
+}
+
+LvePipelineHandle LvePipelineCompiler::Enqueue(GraphicsPipelineDesc desc) {
+  // desc is moved into the task, LvePipeline fixes up PipelineConfigInfo's internal pointers.
+  // Requests matching a live pipeline resolve to it without compiling.
+  Task task{[this, desc = std::move(desc)]() {
+    return lve_device_.pipelineRegistry().acquire(desc.vertFilePath, desc.fragFilePath, desc.configInfo);
+  }};
+  LvePipelineHandle handle{task.get_future().share()};
+  std::lock_guard<std::mutex> lock{mutex_};
+  tasks_.push_back(std::move(task));
+  pending_count_++;
+  return handle;
+}
+
+void LvePipelineCompiler::WorkerLoop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      task_available_.wait(lock, [this] { return is_stopping_ || !tasks_.empty(); });
+      // Drain the queue before stopping, nobody should be left waiting on a handle.
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    // Exceptions end up in the future, get() rethrows them on the caller's thread.
+    task();
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      pending_count_--;
+    }
+    idle_.notify_all();
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+// std lib headers
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+// Everything LvePipeline's constructor takes, so a pipeline can be queued and built later.
+struct GraphicsPipelineDesc {
+  std::string vertFilePath;
+  std::string fragFilePath;
+  PipelineConfigInfo configInfo;
+};
+
+// A pipeline being compiled by LvePipelineCompiler. Cheap to copy, all copies share the result.
+class LvePipelineHandle {
+ public:
+  LvePipelineHandle() = default;
+  explicit LvePipelineHandle(std::shared_future<std::shared_ptr<LvePipeline>> future)
+      : future_{std::move(future)} {}
+
+  bool isValid() const { return future_.valid(); }
+  // True once compiled(or failed), get() won't block then.
+  bool isReady() const {
+    return future_.valid() &&
+           future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+  // Blocks until compiled. Rethrows the exception if compilation failed.
+  LvePipeline &get() const { return *future_.get(); }
+  // Doesn't block: the compiled pipeline if ready, otherwise fallback(e.g a simple default
+  // pipeline built up front), so rendering can start before every pipeline is done.
+  LvePipeline &getOr(LvePipeline &fallback) const { return isReady() ? get() : fallback; }
+  // Blocks like get(), for callers that keep the pipeline beyond the handle.
+  std::shared_ptr<LvePipeline> share() const { return future_.get(); }
+
+ private:
+  std::shared_future<std::shared_ptr<LvePipeline>> future_;
+};
+
+// Compiles graphics pipelines on a pool of worker threads.
+// Problem: vkCreateGraphicsPipelines is slow(shader compilation in the driver) and pipelines are
+// built one by one on the main thread, with many render systems that dominates startup.
+// Solution: queue the pipeline descriptions and build them concurrently. The device's pipeline
+// cache and shader library are thread safe, so workers share them.
+class LvePipelineCompiler {
+ public:
+  // worker_count 0 = one per hardware thread, minus the main thread.
+  explicit LvePipelineCompiler(LveDevice &device, uint32_t worker_count = 0);
+  // Finishes the queued pipelines, then joins the workers.
+  ~LvePipelineCompiler();
+
+  LvePipelineCompiler(const LvePipelineCompiler &) = delete;
+  LvePipelineCompiler &operator=(const LvePipelineCompiler &) = delete;
+
+  LvePipelineHandle compile(GraphicsPipelineDesc desc);
+  // Handles are in the order of descs.
+  std::vector<LvePipelineHandle> compileBatch(std::vector<GraphicsPipelineDesc> descs);
+  // Blocks until every queued pipeline is compiled.
+  void waitIdle();
+
+  uint32_t workerCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+ private:
+  using Task = std::packaged_task<std::shared_ptr<LvePipeline>()>;
+
+  LvePipelineHandle Enqueue(GraphicsPipelineDesc desc);
+  void WorkerLoop();
+
+  LveDevice &lve_device_;
+  std::vector<std::thread> workers_;
+  std::deque<Task> tasks_;
+  // Queued + running tasks.
+  uint32_t pending_count_{0};
+  bool is_stopping_{false};
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::condition_variable idle_;
+};
+
+}  // namespace lve
@@ -0,0 +1,199 @@
+#include "lve_pipeline_registry.hpp"
+
+// std headers
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+namespace lve {
+
+namespace {
+
+class Fnv1a {
+ public:
+  template <typename T>
+  void add(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed.");
+    addBytes(&value, sizeof(T));
+  }
+  void addBytes(const void *data, size_t size) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash_ ^= bytes[i];
+      hash_ *= 1099511628211ull;
+    }
+  }
+  uint64_t hash() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 14695981039346656037ull;
+};
+
+// Appends the bytes of the values, the canonical form of a config compared by the registry.
+class ConfigKeyWriter {
+ public:
+  template <typename T>
+  void add(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written.");
+    addBytes(&value, sizeof(T));
+  }
+  void addBytes(const void *data, size_t size) {
+    key_.append(static_cast<const char *>(data), size);
+  }
+  PipelineConfigKey take() { return std::move(key_); }
+
+ private:
+  PipelineConfigKey key_;
+};
+
+void writeStencilOp(ConfigKeyWriter &writer, const VkStencilOpState &state) {
+  writer.add(state.failOp);
+  writer.add(state.passOp);
+  writer.add(state.depthFailOp);
+  writer.add(state.compareOp);
+  writer.add(state.compareMask);
+  writer.add(state.writeMask);
+  writer.add(state.reference);
+}
+
+void writeSpecialization(ConfigKeyWriter &writer, const SpecializationConstants &constants) {
+  writer.add(constants.mapEntries.size());
+  for (const auto &entry : constants.mapEntries) {
+    writer.add(entry.constantID);
+    writer.add(entry.offset);
+    writer.add(entry.size);
+  }
+  writer.add(constants.data.size());
+  writer.addBytes(constants.data.data(), constants.data.size());
+}
+
+}  // namespace
+
+LvePipelineRegistry::LvePipelineRegistry(LveDevice &device) : lve_device_{device} {}
+
+PipelineConfigKey LvePipelineRegistry::configKey(const PipelineConfigInfo &config_info) {
+  // Field by field, copying the structs whole would pick up padding and pNext/p* pointers.
+  ConfigKeyWriter writer;
+  writer.add(config_info.inputAssemblyInfo.topology);
+  writer.add(config_info.inputAssemblyInfo.primitiveRestartEnable);
+
+  writer.add(config_info.viewportInfo.viewportCount);
+  writer.add(config_info.viewportInfo.scissorCount);
+
+  const auto &rasterization = config_info.rasterizationInfo;
+  writer.add(rasterization.depthClampEnable);
+  writer.add(rasterization.rasterizerDiscardEnable);
+  writer.add(rasterization.polygonMode);
+  writer.add(rasterization.cullMode);
+  writer.add(rasterization.frontFace);
+  writer.add(rasterization.depthBiasEnable);
+  writer.add(rasterization.depthBiasConstantFactor);
+  writer.add(rasterization.depthBiasClamp);
+  writer.add(rasterization.depthBiasSlopeFactor);
+  writer.add(rasterization.lineWidth);
+
+  const auto &multisample = config_info.multisampleInfo;
+  writer.add(multisample.rasterizationSamples);
+  writer.add(multisample.sampleShadingEnable);
+  writer.add(multisample.minSampleShading);
+  writer.add(multisample.alphaToCoverageEnable);
+  writer.add(multisample.alphaToOneEnable);
+
+  const auto &blend_attachment = config_info.colorBlendAttachment;
+  writer.add(blend_attachment.blendEnable);
+  writer.add(blend_attachment.srcColorBlendFactor);
+  writer.add(blend_attachment.dstColorBlendFactor);
+  writer.add(blend_attachment.colorBlendOp);
+  writer.add(blend_attachment.srcAlphaBlendFactor);
+  writer.add(blend_attachment.dstAlphaBlendFactor);
+  writer.add(blend_attachment.alphaBlendOp);
+  writer.add(blend_attachment.colorWriteMask);
+  writer.add(config_info.colorBlendInfo.logicOpEnable);
+  writer.add(config_info.colorBlendInfo.logicOp);
+  writer.add(config_info.colorBlendInfo.attachmentCount);
+  writer.add(config_info.colorBlendInfo.blendConstants);
+
+  const auto &depth_stencil = config_info.depthStencilInfo;
+  writer.add(depth_stencil.depthTestEnable);
+  writer.add(depth_stencil.depthWriteEnable);
+  writer.add(depth_stencil.depthCompareOp);
+  writer.add(depth_stencil.depthBoundsTestEnable);
+  writer.add(depth_stencil.minDepthBounds);
+  writer.add(depth_stencil.maxDepthBounds);
+  writer.add(depth_stencil.stencilTestEnable);
+  writeStencilOp(writer, depth_stencil.front);
+  writeStencilOp(writer, depth_stencil.back);
+
+  writer.add(config_info.bindingDescriptions.size());
+  for (const auto &binding : config_info.bindingDescriptions) {
+    writer.add(binding.binding);
+    writer.add(binding.stride);
+    writer.add(binding.inputRate);
+  }
+  writer.add(config_info.attributeDescriptions.size());
+  for (const auto &attribute : config_info.attributeDescriptions) {
+    writer.add(attribute.location);
+    writer.add(attribute.binding);
+    writer.add(attribute.format);
+    writer.add(attribute.offset);
+  }
+
+  writer.add(config_info.dynamicStateEnables.size());
+  for (VkDynamicState state : config_info.dynamicStateEnables) {
+    writer.add(state);
+  }
+
+  // Handles, not contents: two layouts/render passes created alike still get separate pipelines.
+  writer.add(config_info.pipelineLayout);
+  writer.add(config_info.renderPass);
+  writer.add(config_info.subpass);
+
+  writeSpecialization(writer, config_info.vertSpecialization);
+  writeSpecialization(writer, config_info.fragSpecialization);
+  return writer.take();
+}
+
+size_t LvePipelineRegistry::PipelineKeyHash::operator()(const PipelineKey &key) const {
+  Fnv1a hasher;
+  hasher.addBytes(key.config.data(), key.config.size());
+  hasher.add(key.vertShaderModule);
+  hasher.add(key.fragShaderModule);
+  return static_cast<size_t>(hasher.hash());
+}
+
+std::shared_ptr<LvePipeline> LvePipelineRegistry::acquire(const std::string &vert_file_path,
+                                                          const std::string &frag_file_path,
+                                                          const PipelineConfigInfo &config_info) {
+  // Held until the pipeline is created, so LvePipeline gets the same modules from the library.
+  auto vert_shader_module = lve_device_.shaderLibrary().load(vert_file_path);
+  auto frag_shader_module = lve_device_.shaderLibrary().load(frag_file_path);
+  const PipelineKey key{configKey(config_info), vert_shader_module.get(), frag_shader_module.get()};
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (auto pipeline = pipelines_[key].lock()) {
+      return pipeline;
+    }
+  }
+
+  // Created without the lock, other threads can build different pipelines meanwhile.
+  auto pipeline = std::make_shared<LvePipeline>(lve_device_, vert_file_path, frag_file_path, config_info);
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto &entry = pipelines_[key];
+  // Another thread built the same pipeline first, use theirs so both callers share it.
+  if (auto existing = entry.lock()) {
+    return existing;
+  }
+  entry = pipeline;
+  // Drop entries of pipelines that are gone, amortized over the insertions.
+  if (pipelines_.size() > prune_threshold_) {
+    for (auto it = pipelines_.begin(); it != pipelines_.end();) {
+      it = it->second.expired() ? pipelines_.erase(it) : std::next(it);
+    }
+    prune_threshold_ = std::max(kMinPruneThreshold, 2 * pipelines_.size());
+  }
+  return pipeline;
+}
+
+}  // namespace lve
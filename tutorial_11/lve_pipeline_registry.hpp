@@ -0,0 +1,62 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lve {
+
+// The fields of a PipelineConfigInfo that end up in the pipeline, as bytes. Equal keys mean equal
+// pipeline state. Pointers that PipelineConfigInfo re-points at its own members are skipped,
+// their targets are written instead.
+using PipelineConfigKey = std::string;
+
+// Dedupes graphics pipelines, owned by LveDevice. Requests with the same shader modules(deduped by
+// content in LveShaderLibrary) and the same PipelineConfigInfo get the same LvePipeline, so render
+// systems with identical state don't each compile their own.
+// Like LveShaderLibrary it only keeps weak references, a pipeline lives as long as a system holds it.
+// Thread safe, LvePipelineCompiler's workers go through it.
+class LvePipelineRegistry {
+ public:
+  explicit LvePipelineRegistry(LveDevice &device);
+
+  LvePipelineRegistry(const LvePipelineRegistry &) = delete;
+  LvePipelineRegistry &operator=(const LvePipelineRegistry &) = delete;
+
+  std::shared_ptr<LvePipeline> acquire(const std::string &vert_file_path,
+                                       const std::string &frag_file_path,
+                                       const PipelineConfigInfo &config_info);
+
+  static PipelineConfigKey configKey(const PipelineConfigInfo &config_info);
+
+ private:
+  static constexpr size_t kMinPruneThreshold = 64;
+
+  // The modules are compared by address, a live pipeline keeps its modules alive so the address
+  // can't be reused by another module while the entry matters.
+  struct PipelineKey {
+    PipelineConfigKey config;
+    const LveShaderModule *vertShaderModule;
+    const LveShaderModule *fragShaderModule;
+
+    bool operator==(const PipelineKey &other) const {
+      return vertShaderModule == other.vertShaderModule && fragShaderModule == other.fragShaderModule &&
+             config == other.config;
+    }
+  };
+  struct PipelineKeyHash {
+    size_t operator()(const PipelineKey &key) const;
+  };
+
+  LveDevice &lve_device_;
+  std::mutex mutex_;
+  std::unordered_map<PipelineKey, std::weak_ptr<LvePipeline>, PipelineKeyHash> pipelines_;
+  size_t prune_threshold_{kMinPruneThreshold};
+};
+
+}  // namespace lve
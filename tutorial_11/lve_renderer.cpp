@@ -1,12 +1,14 @@
 #include "lve_renderer.hpp"
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 
 namespace lve {
 
-LveRenderer::LveRenderer(LveWindow& window, LveDevice& device) : lve_window_(window), lve_device_(device) {
+LveRenderer::LveRenderer(LveWindow& window, LveDevice& device, const SwapChainConfig& config)
+    : lve_window_(window), lve_device_(device), swap_chain_config_(config) {
+  // Also creates the per-frame command buffers and compute resources.
   RecreateSwapChain();
-  CreateCommandBuffers();
 };
 
 
@@ -14,6 +16,7 @@ LveRenderer::~LveRenderer() {
   // Didn't need to free before when in FirstApp, because app and command buffer + cmd buffer pool
   // life cycle used to be tied together. but now, we can destroy renderer while app continue.
   FreeCommandBuffers();
+  FreeComputeResources();
 }
 
 void LveRenderer::CreateCommandBuffers(){
@@ -22,7 +25,7 @@ void LveRenderer::CreateCommandBuffers(){
   // requires target frame buffer id, we need to re-record the command buffer.
   // To simplify things, for now, we set 1 command buffer to be in charge of
   // 1 frame buffer.
-  command_buffers_.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  command_buffers_.resize(lve_swap_chain_->framesInFlight());
   VkCommandBufferAllocateInfo alloc_info{};
   alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   // Primary = can be sent to queue for execution. but cannot be called by other command buffers.
@@ -39,6 +42,41 @@ void LveRenderer::CreateCommandBuffers(){
   }
 };
 
+void LveRenderer::CreateComputeResources() {
+  compute_command_buffers_.resize(lve_swap_chain_->framesInFlight());
+  VkCommandBufferAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  // Has to come from a pool of the family of the queue it is submitted to.
+  alloc_info.commandPool = lve_device_.getComputeCommandPool();
+  alloc_info.commandBufferCount = static_cast<uint32_t>(compute_command_buffers_.size());
+  if(vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, compute_command_buffers_.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute command buffer.");
+  }
+
+  compute_finished_semaphores_.resize(lve_swap_chain_->framesInFlight());
+  VkSemaphoreCreateInfo semaphore_info{};
+  semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  for (auto &semaphore : compute_finished_semaphores_) {
+    if(vkCreateSemaphore(lve_device_.device(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create compute semaphore.");
+    }
+  }
+}
+
+void LveRenderer::FreeComputeResources() {
+  vkFreeCommandBuffers(
+      lve_device_.device(),
+      lve_device_.getComputeCommandPool(),
+      static_cast<uint32_t>(compute_command_buffers_.size()),
+      compute_command_buffers_.data());
+  compute_command_buffers_.clear();
+  for (auto semaphore : compute_finished_semaphores_) {
+    vkDestroySemaphore(lve_device_.device(), semaphore, nullptr);
+  }
+  compute_finished_semaphores_.clear();
+}
+
 void LveRenderer::RecreateSwapChain() {
   auto extent = lve_window_.getExtend();
   // If window is minimized.
@@ -47,21 +85,89 @@ void LveRenderer::RecreateSwapChain() {
     // Puts thread to sleep until new events detected / Wait for new events
     glfwWaitEvents();
   }
-  // To wait on the host for the completion of outstanding queue operations for all queues on a given logical device.
-  vkDeviceWaitIdle(lve_device_.device());
+  // No vkDeviceWaitIdle here, the old swap chain keeps rendering resources alive for the frames
+  // still in flight and is retired later(see ReleaseRetiredResources).
 
   // If there exist no current swapchain make a fresh one.
   // Otherwise make a new one that is based on old one for optimizing by reuse of resources.
   if(lve_swap_chain_ == nullptr) {
-    lve_swap_chain_ = std::make_unique<LveSwapChain>(lve_device_, lve_window_.getExtend());
+    lve_swap_chain_ = std::make_unique<LveSwapChain>(lve_device_, lve_window_.getExtend(), swap_chain_config_);
   } else {
     // Using move, since lve_swap_chain_ is unique pointer, s.t we can move the resource to the shared_ptr that
     // we will be using for the new swap chain constructor.
     std::shared_ptr<LveSwapChain> old_swap_chain = std::move(lve_swap_chain_);
-    lve_swap_chain_ = std::make_unique<LveSwapChain>(lve_device_, lve_window_.getExtend(), old_swap_chain);
-    if (!old_swap_chain->compareSwapFormats(*lve_swap_chain_.get())) {
-      throw std::runtime_error("Swap chain image(or depth) format has changed! New incompatible render pass created.");
+    lve_swap_chain_ = std::make_unique<LveSwapChain>(
+        lve_device_, lve_window_.getExtend(), old_swap_chain, swap_chain_config_);
+    bool is_render_pass_compatible = old_swap_chain->compareSwapFormats(*lve_swap_chain_.get());
+    if (is_render_pass_compatible && old_swap_chain->framesInFlight() == lve_swap_chain_->framesInFlight()) {
+      // Sync objects moved to the new swap chain, after framesInFlight more frames each of them
+      // has been waited on in acquireNextImage and the old one is unused.
+      retired_swap_chains_.push_back({old_swap_chain, frame_counter_ + lve_swap_chain_->framesInFlight()});
+    } else {
+      // Frame count or attachment formats changed(explicit reconfiguration, not a plain resize).
+      // Per-frame resources and pipelines get rebuilt, so wait for everything still running.
+      // The fences are in the old swap chain, or in the new one if they were handed over.
+      old_swap_chain->waitForFrames();
+      lve_swap_chain_->waitForFrames();
+      retired_swap_chains_.clear();
+    }
+  }
+  is_config_dirty_ = false;
+  // Sync objects(and their frame index) are either carried over or start at 0, stay in step.
+  current_frame_idx_ = static_cast<int>(lve_swap_chain_->getCurrentFrame());
+
+  // Per-frame resources follow the number of frames in flight.
+  if (command_buffers_.size() != lve_swap_chain_->framesInFlight()) {
+    if (!command_buffers_.empty()) {
+      FreeCommandBuffers();
+      FreeComputeResources();
     }
+    CreateCommandBuffers();
+    CreateComputeResources();
+  }
+}
+
+void LveRenderer::ReleaseRetiredResources() {
+  retired_swap_chains_.erase(
+      std::remove_if(
+          retired_swap_chains_.begin(),
+          retired_swap_chains_.end(),
+          [this](const RetiredSwapChain &retired) { return frame_counter_ >= retired.retire_frame; }),
+      retired_swap_chains_.end());
+  deferred_releases_.erase(
+      std::remove_if(
+          deferred_releases_.begin(),
+          deferred_releases_.end(),
+          [this](const DeferredRelease &deferred) { return frame_counter_ >= deferred.release_frame; }),
+      deferred_releases_.end());
+}
+
+void LveRenderer::deferRelease(std::shared_ptr<void> resource) {
+  // Same reasoning as for retired swap chains, after framesInFlight more frames every fence of
+  // the frames in flight now has been waited on.
+  deferred_releases_.push_back({std::move(resource), frame_counter_ + lve_swap_chain_->framesInFlight()});
+}
+
+void LveRenderer::setFramesInFlight(uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "Need at least one frame in flight.");
+  if (swap_chain_config_.framesInFlight != frames_in_flight) {
+    swap_chain_config_.framesInFlight = frames_in_flight;
+    is_config_dirty_ = true;
+  }
+}
+
+// Present mode is baked into the swap chain, switching goes through RecreateSwapChain.
+void LveRenderer::setPresentMode(PresentModePolicy present_mode) {
+  if (swap_chain_config_.presentMode != present_mode) {
+    swap_chain_config_.presentMode = present_mode;
+    is_config_dirty_ = true;
+  }
+}
+
+void LveRenderer::setImageCount(uint32_t image_count) {
+  if (swap_chain_config_.imageCount != image_count) {
+    swap_chain_config_.imageCount = image_count;
+    is_config_dirty_ = true;
   }
 }
 
@@ -77,6 +183,10 @@ void LveRenderer::FreeCommandBuffers() {
 // Starts a command frame to start recording
 VkCommandBuffer LveRenderer::beginFrame() {
   assert(!is_frame_started_ && "Cannot start beginFrame when another frame is already in progess.");
+  // Config changed since the last frame, nothing is recorded right now so rebuild here.
+  if (is_config_dirty_) {
+    RecreateSwapChain();
+  }
   // Fetch index to the frame we should render next.
   // Automatically handle cpu-gpu synchronisation for double/triple buffering.
   // result show if it is successful.
@@ -92,6 +202,8 @@ VkCommandBuffer LveRenderer::beginFrame() {
     // Might also occur when windows is resized, we will fix this later.
     throw std::runtime_error("Failed to acquire next swapchain image");
   }
+  // Acquire waited on this frame's fence, old swap chains/resources may be done now.
+  ReleaseRetiredResources();
   is_frame_started_ = true;
   auto command_buffer = getCurrentCommandBuffer();
   // Record/draw command for buffer whose id is image_index.
@@ -113,7 +225,15 @@ void LveRenderer::endFrame() {
   // Submit cmd_buffer to device graphic queue while handling cpu-gpu sync.
   // cmd buffer will then be executed, then swap chain will present associated
   // color attachment image view to the display at the appropriate time based on present_mode(mailbox/fifo).
-  auto result = lve_swap_chain_->submitCommandBuffers(&command_buffer, &current_img_idx_);
+  assert(!is_compute_started_ && "Cannot end frame while compute command buffer is still recording.");
+  auto result = lve_swap_chain_->submitCommandBuffers(
+      &command_buffer, &current_img_idx_, frame_wait_semaphores_, frame_wait_stages_);
+  frame_wait_semaphores_.clear();
+  frame_wait_stages_.clear();
+  frame_counter_++;
+
+  is_frame_started_ = false;
+  current_frame_idx_ = (current_frame_idx_ + 1) % lve_swap_chain_->framesInFlight();
 
   // Update swapchain + reset flag when window size changed.
   if (result == VK_ERROR_OUT_OF_DATE_KHR  || result == VK_SUBOPTIMAL_KHR || lve_window_.wasWindowResized()) {
@@ -122,8 +242,49 @@ void LveRenderer::endFrame() {
   } else if(result != VK_SUCCESS) {
     throw std::runtime_error("Failed to present swap chain image.");
   }
-  is_frame_started_ = false;
-  current_frame_idx_ = (current_frame_idx_ + 1)% LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+}
+
+VkCommandBuffer LveRenderer::beginCompute() {
+  assert(is_frame_started_ && "Cannot begin compute when frame is not in process.");
+  assert(!is_compute_started_ && "Compute command buffer of this frame is already recording.");
+  // Safe to reset, the frame fence waited in beginFrame covers the last use of this buffer.
+  auto compute_command_buffer = compute_command_buffers_[current_frame_idx_];
+  vkResetCommandBuffer(compute_command_buffer, 0);
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if(vkBeginCommandBuffer(compute_command_buffer, &begin_info) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin recording compute command buffer.");
+  }
+  is_compute_started_ = true;
+  return compute_command_buffer;
+}
+
+void LveRenderer::endCompute(VkCommandBuffer compute_command_buffer, VkPipelineStageFlags wait_stage) {
+  assert(is_compute_started_ && "Cannot end compute that was not started.");
+  assert(compute_command_buffer == compute_command_buffers_[current_frame_idx_] &&
+         "Cannot end compute command buffer from different frame.");
+  if(vkEndCommandBuffer(compute_command_buffer) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to end recording compute command buffer.");
+  }
+  VkSemaphore compute_finished = compute_finished_semaphores_[current_frame_idx_];
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &compute_command_buffer;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &compute_finished;
+  if(vkQueueSubmit(lve_device_.computeQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit compute command buffer.");
+  }
+  is_compute_started_ = false;
+  addWaitSemaphore(compute_finished, wait_stage);
+}
+
+void LveRenderer::addWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags wait_stage) {
+  assert(is_frame_started_ && "Cannot add wait semaphore when frame is not in process.");
+  frame_wait_semaphores_.push_back(semaphore);
+  frame_wait_stages_.push_back(wait_stage);
 }
 
 // Since renderer class manage swapchain and it's render pass.
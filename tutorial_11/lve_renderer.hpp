@@ -9,7 +9,7 @@
 namespace lve {
 class LveRenderer {
   public:
-    LveRenderer(LveWindow &window, LveDevice &device);
+    LveRenderer(LveWindow &window, LveDevice &device, const SwapChainConfig &config = {});
     ~LveRenderer();
     LveRenderer(const LveRenderer &) = delete;
     LveRenderer &operator=(const LveRenderer &) = delete;
@@ -19,14 +19,53 @@ class LveRenderer {
     // end the command frame recording and execute.
     void endFrame();
 
+    // Compute work of the current frame, recorded between beginFrame and endFrame.
+    // Submitted to the compute queue(async compute when the device has a separate family) on
+    // endCompute, and the frame's graphics submission waits for it only at wait_stage. So compute
+    // of this frame overlaps rasterisation of the previous one instead of running in series.
+    // Buffers written here and read by graphics need VK_SHARING_MODE_CONCURRENT or an ownership
+    // transfer when device has async compute(QueueFamilyIndices::hasAsyncCompute).
+    VkCommandBuffer beginCompute();
+    void endCompute(VkCommandBuffer compute_command_buffer, VkPipelineStageFlags wait_stage);
+    // Make this frame's graphics submission wait on an extra semaphore, e.g signaled by the
+    // user's own compute submission.
+    void addWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags wait_stage);
+
     // Since renderer class manage swapchain and it's render pass.
     void beginSwapChainRenderPass (VkCommandBuffer command_buffer);
     void endSwapChainRenderPass (VkCommandBuffer command_buffer);
 
+    // Latency/throughput trade-off, can be changed while running. Takes effect at the start of
+    // the next frame, the swap chain and every per-frame resource are rebuilt to match.
+    void setFramesInFlight(uint32_t frames_in_flight);
+    // 0 = let the swap chain pick(minImageCount + 1).
+    void setImageCount(uint32_t image_count);
+    // e.g kImmediate for benchmarks, kFifo for interactive sessions. Also applied at the next frame.
+    void setPresentMode(PresentModePolicy present_mode);
+    PresentModePolicy getPresentMode() const {
+      return swap_chain_config_.presentMode;
+    }
+    uint32_t getFramesInFlight() const {
+      return lve_swap_chain_->framesInFlight();
+    }
+
     // Tracking state of current in-progress frame.
     VkRenderPass getSwapChainRenderPass() const {
       return lve_swap_chain_->getRenderPass();
     }
+    // Changes only when the swap chain formats change, render systems rebuild their pipelines then.
+    RenderPassCompatibility getRenderPassCompatibility() const {
+      return lve_swap_chain_->getRenderPassCompatibility();
+    }
+
+    // Keeps resource(e.g a replaced pipeline) alive until the frames currently in flight, which
+    // may still use it, have finished on the gpu. Never blocks.
+    void deferRelease(std::shared_ptr<void> resource);
+
+    // Number of frames submitted so far.
+    uint64_t getFrameCounter() const {
+      return frame_counter_;
+    }
 
     bool isFrameInProgess() const {
       return is_frame_started_;
@@ -45,16 +84,43 @@ class LveRenderer {
 
   protected:
     void CreateCommandBuffers();
+    void CreateComputeResources();
     void drawFrame();
     void RecreateSwapChain();
     void FreeCommandBuffers();
+    void FreeComputeResources();
+    void ReleaseRetiredResources();
 
     LveWindow& lve_window_;
     LveDevice& lve_device_;
     // Using pointer for easy rather than stack allocated, makes it easy to point to new
     // swapchains. but slightly worst performance.
     std::unique_ptr<LveSwapChain> lve_swap_chain_;
+    // Config used for the next swap chain, applied when is_config_dirty_ at frame boundary.
+    SwapChainConfig swap_chain_config_;
+    bool is_config_dirty_{false};
+    // Replaced swap chains whose frames may still be executing. Destroyed once frame_counter_
+    // reaches retire_frame, by then every in-flight fence they used has been waited on.
+    struct RetiredSwapChain {
+      std::shared_ptr<LveSwapChain> swap_chain;
+      uint64_t retire_frame;
+    };
+    std::vector<RetiredSwapChain> retired_swap_chains_;
+    // Same, for resources handed to deferRelease.
+    struct DeferredRelease {
+      std::shared_ptr<void> resource;
+      uint64_t release_frame;
+    };
+    std::vector<DeferredRelease> deferred_releases_;
+    uint64_t frame_counter_{0};
     std::vector<VkCommandBuffer> command_buffers_;
+    // One compute command buffer and finished semaphore per frame in flight. They're safe to
+    // reuse once the frame's fence signaled, since the graphics submission waited on the semaphore.
+    std::vector<VkCommandBuffer> compute_command_buffers_;
+    std::vector<VkSemaphore> compute_finished_semaphores_;
+    std::vector<VkSemaphore> frame_wait_semaphores_;
+    std::vector<VkPipelineStageFlags> frame_wait_stages_;
+    bool is_compute_started_{false};
 
     uint32_t current_img_idx_{0};
     // Track frames (this makes frame independent from image.)
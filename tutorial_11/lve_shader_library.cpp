@@ -0,0 +1,155 @@
+#include "lve_shader_library.hpp"
+#include "lve_embedded_shaders.hpp"
+
+// posix headers
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// std headers
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t kSpirvMagic = 0x07230203;
+
+// Read only mapping of a whole file, unmapped when it goes out of scope.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("failed to open file " + file_path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      close(fd);
+      throw std::runtime_error("failed to stat file " + file_path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (data_ == MAP_FAILED) {
+      data_ = nullptr;
+      throw std::runtime_error("failed to map file " + file_path);
+    }
+  }
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Page aligned, so it can be read as SPIR-V words directly.
+  const uint32_t *words() const { return static_cast<const uint32_t *>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+LveShaderLibrary::LveShaderLibrary(VkDevice device) : device_{device} {}
+
+uint64_t LveShaderLibrary::hashSpirv(const uint32_t *code, size_t size) {
+  // 64 bit FNV-1a over the bytes.
+  const auto *bytes = reinterpret_cast<const uint8_t *>(code);
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::shared_ptr<LveShaderModule> LveShaderLibrary::load(const std::string &file_path) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto it = modules_by_path_.find(file_path);
+    if (it != modules_by_path_.end()) {
+      if (auto module = it->second.lock()) {
+        return module;
+      }
+    }
+  }
+
+  bool is_changed_on_disk;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    is_changed_on_disk = changed_on_disk_.count(file_path) != 0;
+  }
+  SpirvSpan embedded = is_changed_on_disk ? SpirvSpan{} : findEmbeddedShader(file_path);
+  if (!embedded.empty()) {
+    uint64_t hash = hashSpirv(embedded.code, embedded.size);
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto module = findOrCreate(embedded.code, embedded.size, hash);
+    modules_by_path_[file_path] = module;
+    return module;
+  }
+
+  // File I/O and hashing outside the lock, other threads keep getting cached modules meanwhile.
+  MappedFile file{file_path};
+  if (file.size() < sizeof(uint32_t) || file.size() % sizeof(uint32_t) != 0 ||
+      file.words()[0] != kSpirvMagic) {
+    throw std::runtime_error("not a SPIR-V file " + file_path);
+  }
+  uint64_t hash = hashSpirv(file.words(), file.size());
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto module = findOrCreate(file.words(), file.size(), hash);
+  modules_by_path_[file_path] = module;
+  return module;
+}
+
+void LveShaderLibrary::invalidate(const std::string &file_path) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  modules_by_path_.erase(file_path);
+  if (!findEmbeddedShader(file_path).empty()) {
+    changed_on_disk_.insert(file_path);
+  }
+}
+
+std::shared_ptr<LveShaderModule> LveShaderLibrary::loadFromMemory(const uint32_t *code, size_t size) {
+  if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0 || code[0] != kSpirvMagic) {
+    throw std::runtime_error("invalid SPIR-V code");
+  }
+  uint64_t hash = hashSpirv(code, size);
+  std::lock_guard<std::mutex> lock{mutex_};
+  return findOrCreate(code, size, hash);
+}
+
+std::shared_ptr<LveShaderModule> LveShaderLibrary::findOrCreate(
+    const uint32_t *code, size_t size, uint64_t hash) {
+  auto it = modules_by_hash_.find(hash);
+  if (it != modules_by_hash_.end()) {
+    auto module = it->second.lock();
+    if (module != nullptr && module->hasCode(code, size)) {
+      return module;
+    }
+  }
+
+  VkShaderModuleCreateInfo create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  create_info.codeSize = size;
+  create_info.pCode = code;
+  VkShaderModule shader_module;
+  if (vkCreateShaderModule(device_, &create_info, nullptr, &shader_module) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create shader module.");
+  }
+  auto module = std::make_shared<LveShaderModule>(device_, shader_module, hash, code, size);
+  modules_by_hash_[hash] = module;
+  return module;
+}
+
+}  // namespace lve
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lve {
+
+// SPIR-V in memory, size in bytes.
+struct SpirvSpan {
+  const uint32_t *code = nullptr;
+  size_t size = 0;
+
+  bool empty() const { return code == nullptr; }
+};
+
+// A VkShaderModule shared by every pipeline built from the same SPIR-V. Handed out as
+// std::shared_ptr by LveShaderLibrary, the module is destroyed with the last pipeline using it.
+class LveShaderModule {
+ public:
+  LveShaderModule(VkDevice device, VkShaderModule module, uint64_t hash, const uint32_t *code, size_t size)
+      : device_{device}, module_{module}, hash_{hash}, code_(code, code + size / sizeof(uint32_t)) {}
+  ~LveShaderModule() { vkDestroyShaderModule(device_, module_, nullptr); }
+
+  LveShaderModule(const LveShaderModule &) = delete;
+  LveShaderModule &operator=(const LveShaderModule &) = delete;
+
+  VkShaderModule module() const { return module_; }
+  // FNV-1a hash of the SPIR-V words, identifies the shader's content.
+  uint64_t hash() const { return hash_; }
+  // True if the module was created from exactly this SPIR-V, size in bytes. Equal hashes don't
+  // prove equal code.
+  bool hasCode(const uint32_t *code, size_t size) const {
+    return size == code_.size() * sizeof(uint32_t) && std::equal(code_.begin(), code_.end(), code);
+  }
+
+ private:
+  VkDevice device_;
+  VkShaderModule module_;
+  uint64_t hash_;
+  // Copy of the SPIR-V, a few KB per shader.
+  std::vector<uint32_t> code_;
+};
+
+// Loads SPIR-V and dedupes shader modules by content, owned by LveDevice.
+// Files are memory mapped instead of read into a buffer, and a path already loaded doesn't touch
+// the file system again. Two paths with identical content share one module.
+// Paths with shaders compiled into the binary(see findEmbeddedShader) are served from memory,
+// until invalidate says the file changed(hot reload) and it's read from disk from then on.
+// The library only keeps weak references, modules live as long as a pipeline holds them.
+// Thread safe, pipelines can be built from several threads.
+class LveShaderLibrary {
+ public:
+  explicit LveShaderLibrary(VkDevice device);
+
+  LveShaderLibrary(const LveShaderLibrary &) = delete;
+  LveShaderLibrary &operator=(const LveShaderLibrary &) = delete;
+
+  std::shared_ptr<LveShaderModule> load(const std::string &file_path);
+  // Forget the module cached for file_path, the next load reads the file again(e.g after it was
+  // recompiled), even when it's embedded. Pipelines keep the module they already hold.
+  void invalidate(const std::string &file_path);
+  // SPIR-V already in memory. size in bytes, must be a multiple of 4.
+  std::shared_ptr<LveShaderModule> loadFromMemory(const uint32_t *code, size_t size);
+
+  static uint64_t hashSpirv(const uint32_t *code, size_t size);
+
+ private:
+  // Expects mutex_ to be held.
+  std::shared_ptr<LveShaderModule> findOrCreate(const uint32_t *code, size_t size, uint64_t hash);
+
+  VkDevice device_;
+  std::mutex mutex_;
+  // A hash collision replaces the entry, the module already there lives on with its pipelines.
+  std::unordered_map<uint64_t, std::weak_ptr<LveShaderModule>> modules_by_hash_;
+  std::unordered_map<std::string, std::weak_ptr<LveShaderModule>> modules_by_path_;
+  // Embedded paths invalidated since, loaded from the file system instead.
+  std::unordered_set<std::string> changed_on_disk_;
+};
+
+}  // namespace lve
@@ -0,0 +1,152 @@
+#include "lve_shader_watcher.hpp"
+
+#if defined(__linux__)
+// posix headers
+#include <poll.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+extern char **environ;
+#endif
+
+// std headers
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+bool EndsWith(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Runs argv[0](looked up in PATH) with argv and waits for it. No shell, the file names inotify
+// reports are passed as they are. True if it exited with 0.
+bool RunProcess(const std::vector<std::string> &argv) {
+#if defined(__linux__)
+  std::vector<char *> args;
+  for (const auto &arg : argv) {
+    args.push_back(const_cast<char *>(arg.c_str()));
+  }
+  args.push_back(nullptr);
+  pid_t pid;
+  if (posix_spawnp(&pid, args[0], nullptr, nullptr, args.data(), environ) != 0) {
+    return false;
+  }
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+#if defined(__linux__)
+
+LveShaderWatcher::LveShaderWatcher(const std::string &directory) : directory_{directory} {
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0 || pipe(stop_pipe_) != 0) {
+    std::cerr << "Shader hot reload disabled, failed to init inotify" << std::endl;
+    return;
+  }
+  // CLOSE_WRITE: file saved in place. MOVED_TO: editors/compilers writing a temp file then renaming.
+  watch_descriptor_ = inotify_add_watch(inotify_fd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watch_descriptor_ < 0) {
+    std::cerr << "Shader hot reload disabled, cannot watch " << directory_ << std::endl;
+    return;
+  }
+  thread_ = std::thread(&LveShaderWatcher::WatchLoop, this);
+}
+
+LveShaderWatcher::~LveShaderWatcher() {
+  if (thread_.joinable()) {
+    // The pipe is empty, one byte only fails when interrupted. Always joined, WatchLoop polls the
+    // fds closed below.
+    char stop = 1;
+    while (write(stop_pipe_[1], &stop, 1) < 0 && errno == EINTR) {
+    }
+    thread_.join();
+  }
+  for (int fd : stop_pipe_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+}
+
+void LveShaderWatcher::WatchLoop() {
+  // Large enough for several events, inotify_event is followed by its variable length name.
+  alignas(inotify_event) char buffer[4096];
+  pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      continue;
+    }
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+    ssize_t length;
+    while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+      for (char *ptr = buffer; ptr < buffer + length;) {
+        auto *event = reinterpret_cast<inotify_event *>(ptr);
+        if (event->len > 0) {
+          OnFileWritten(event->name);
+        }
+        ptr += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+}
+
+#else
+
+LveShaderWatcher::LveShaderWatcher(const std::string &directory) : directory_{directory} {
+  std::cerr << "Shader hot reload is only supported on Linux" << std::endl;
+}
+
+LveShaderWatcher::~LveShaderWatcher() {}
+
+void LveShaderWatcher::WatchLoop() {}
+
+#endif
+
+void LveShaderWatcher::OnFileWritten(const std::string &name) {
+  std::string path = directory_ + "/" + name;
+  if (EndsWith(name, ".spv")) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    changed_files_.insert(path);
+    return;
+  }
+  if (EndsWith(name, ".vert") || EndsWith(name, ".frag") || EndsWith(name, ".comp")) {
+    // Runs on the watcher thread, the render loop keeps going while glslc compiles. Writing the
+    // .spv then shows up as its own event. On a compile error glslc prints it and nothing changes.
+    const char *glslc = std::getenv("LVE_GLSLC");
+    if (!RunProcess({glslc != nullptr ? glslc : "glslc", path, "-o", path + ".spv"})) {
+      std::cerr << "Failed to compile " << path << ", keeping the old shader" << std::endl;
+    }
+  }
+}
+
+std::vector<std::string> LveShaderWatcher::takeChangedFiles() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  std::vector<std::string> changed(changed_files_.begin(), changed_files_.end());
+  changed_files_.clear();
+  return changed;
+}
+
+}  // namespace lve
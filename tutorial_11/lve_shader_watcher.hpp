@@ -0,0 +1,43 @@
+#pragma once
+
+// std lib headers
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+// Watches a shader directory in the background(inotify, Linux only, a no-op elsewhere).
+// A saved GLSL source(.vert/.frag/.comp) is recompiled with glslc(LVE_GLSLC, default "glslc")
+// next to it as <source>.spv. Every .spv that is rewritten, by glslc or e.g `make`, is reported
+// by takeChangedFiles(), polled from the render loop to rebuild the pipelines using it.
+class LveShaderWatcher {
+ public:
+  explicit LveShaderWatcher(const std::string &directory);
+  ~LveShaderWatcher();
+
+  LveShaderWatcher(const LveShaderWatcher &) = delete;
+  LveShaderWatcher &operator=(const LveShaderWatcher &) = delete;
+
+  bool isWatching() const { return watch_descriptor_ >= 0; }
+  // .spv paths("<directory>/<name>.spv") changed since the last call. Doesn't block.
+  std::vector<std::string> takeChangedFiles();
+
+ private:
+  void WatchLoop();
+  void OnFileWritten(const std::string &name);
+
+  std::string directory_;
+  int inotify_fd_{-1};
+  int watch_descriptor_{-1};
+  // Written to wake up and stop WatchLoop.
+  int stop_pipe_[2]{-1, -1};
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::set<std::string> changed_files_;
+};
+
+}  // namespace lve
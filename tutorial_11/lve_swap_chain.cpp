@@ -1,6 +1,7 @@
 #include "lve_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -11,21 +12,28 @@
 
 namespace lve {
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent, const SwapChainConfig &config)
+    : device{deviceRef}, windowExtent{extent}, config{config} {
   init();
 }
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent, std::shared_ptr<LveSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+LveSwapChain::LveSwapChain(
+    LveDevice &deviceRef,
+    VkExtent2D extent,
+    std::shared_ptr<LveSwapChain> previous,
+    const SwapChainConfig &config)
+    : device{deviceRef}, windowExtent{extent}, config{config}, oldSwapChain{previous} {
   init();
 
-  // Clean up old swap chain, since it's only usde during initialization.
-  // Setting the shared_ptr to null, tells C++ that the resource is no longer needed, and it can release it.
+  // Old swap chain is only used during initialization. Dropping our reference doesn't destroy it
+  // yet, the caller keeps it alive(see LveRenderer::RecreateSwapChain) until its frames are done.
   oldSwapChain = nullptr;
 }
 
 void LveSwapChain::init() {
+  if (config.framesInFlight == 0) {
+    throw std::runtime_error("swap chain needs at least 1 frame in flight!");
+  }
   createSwapChain();
   createImageViews();
   createRenderPass();
@@ -48,24 +56,38 @@ LveSwapChain::~LveSwapChain() {
 
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    device.destroyImage(depthImages[i], depthImageAllocations[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  // Null if handed over to the next swap chain.
+  if (renderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  }
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  // cleanup synchronization objects(none left if they were handed over to the next swap chain).
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.device(), inFlightFences[i], nullptr);
   }
 }
 
+void LveSwapChain::waitForFrames() {
+  if (inFlightFences.empty()) {
+    return;
+  }
+  vkWaitForFences(
+      device.device(),
+      static_cast<uint32_t>(inFlightFences.size()),
+      inFlightFences.data(),
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+}
+
 VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
   vkWaitForFences(
       device.device(),
@@ -86,7 +108,10 @@ VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
 }
 
 VkResult LveSwapChain::submitCommandBuffers(
-    const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+    const VkCommandBuffer *buffers,
+    uint32_t *imageIndex,
+    const std::vector<VkSemaphore> &extraWaitSemaphores,
+    const std::vector<VkPipelineStageFlags> &extraWaitStages) {
   if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
     vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
@@ -95,11 +120,14 @@ VkResult LveSwapChain::submitCommandBuffers(
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  std::vector<VkSemaphore> waitSemaphores = {imageAvailableSemaphores[currentFrame]};
+  std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  waitSemaphores.insert(
+      waitSemaphores.end(), extraWaitSemaphores.begin(), extraWaitSemaphores.end());
+  waitStages.insert(waitStages.end(), extraWaitStages.begin(), extraWaitStages.end());
+  submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask = waitStages.data();
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
@@ -128,7 +156,7 @@ VkResult LveSwapChain::submitCommandBuffers(
 
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % config.framesInFlight;
 
   return result;
 }
@@ -140,7 +168,9 @@ void LveSwapChain::createSwapChain() {
   VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  uint32_t imageCount = config.imageCount != 0 ? config.imageCount
+                                                : swapChainSupport.capabilities.minImageCount + 1;
+  imageCount = std::max(imageCount, swapChainSupport.capabilities.minImageCount);
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -216,9 +246,19 @@ void LveSwapChain::createImageViews() {
 }
 
 void LveSwapChain::createRenderPass() {
+  swapChainDepthFormat = findDepthFormat();
+  // Compatible with the old swap chain's render pass(usually a plain resize): take it over, so
+  // the handle stays the same and pipelines don't need to be recreated.
+  if (oldSwapChain != nullptr && oldSwapChain->renderPass != VK_NULL_HANDLE &&
+      compareSwapFormats(*oldSwapChain)) {
+    renderPass = oldSwapChain->renderPass;
+    oldSwapChain->renderPass = VK_NULL_HANDLE;
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
-  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.format = swapChainDepthFormat;
+  depthAttachment.samples = swapChainSamples;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -232,7 +272,7 @@ void LveSwapChain::createRenderPass() {
 
   VkAttachmentDescription colorAttachment = {};
   colorAttachment.format = getSwapChainImageFormat();
-  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.samples = swapChainSamples;
   colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -302,12 +342,11 @@ void LveSwapChain::createFramebuffers() {
 }
 
 void LveSwapChain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
-  swapChainDepthFormat = depthFormat;
+  VkFormat depthFormat = swapChainDepthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
   depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
+  depthImageAllocations.resize(imageCount());
   depthImageViews.resize(imageCount());
 
   for (int i = 0; i < depthImages.size(); i++) {
@@ -323,7 +362,7 @@ void LveSwapChain::createDepthResources() {
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.samples = swapChainSamples;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
@@ -331,7 +370,7 @@ void LveSwapChain::createDepthResources() {
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         depthImages[i],
-        depthImageMemorys[i]);
+        depthImageAllocations[i]);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -351,11 +390,26 @@ void LveSwapChain::createDepthResources() {
 }
 
 void LveSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
+  // Same number of frames: take over the old chain's semaphores and fences instead of creating new
+  // ones. The fences keep tracking the frames still in flight on the old chain, so waiting on them
+  // in acquireNextImage is also what tells when the old chain can be destroyed.
+  if (oldSwapChain != nullptr && oldSwapChain->config.framesInFlight == config.framesInFlight) {
+    imageAvailableSemaphores = std::move(oldSwapChain->imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(oldSwapChain->renderFinishedSemaphores);
+    inFlightFences = std::move(oldSwapChain->inFlightFences);
+    currentFrame = oldSwapChain->currentFrame;
+    oldSwapChain->imageAvailableSemaphores.clear();
+    oldSwapChain->renderFinishedSemaphores.clear();
+    oldSwapChain->inFlightFences.clear();
+    return;
+  }
+
+  imageAvailableSemaphores.resize(config.framesInFlight);
+  renderFinishedSemaphores.resize(config.framesInFlight);
+  inFlightFences.resize(config.framesInFlight);
+
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
@@ -363,7 +417,7 @@ void LveSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < config.framesInFlight; i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
@@ -389,24 +443,44 @@ VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR LveSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      std::cout << "Present mode: Mailbox" << std::endl;
-      return availablePresentMode;
-    }
+  auto isAvailable = [&](VkPresentModeKHR mode) {
+    return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) !=
+           availablePresentModes.end();
+  };
+
+  switch (config.presentMode) {
+    case PresentModePolicy::kImmediate:
+      // Immediate == greedy method, no sync needed just present buffers now.
+      // although has higher power consumption and causes tearing.
+      if (isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+        std::cout << "Present mode: Immediate" << std::endl;
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+      }
+      // Next best uncapped mode.
+      if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) {
+        std::cout << "Present mode: Mailbox" << std::endl;
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+      }
+      break;
+    case PresentModePolicy::kMailbox:
+      if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) {
+        std::cout << "Present mode: Mailbox" << std::endl;
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+      }
+      break;
+    case PresentModePolicy::kFifoRelaxed:
+      if (isAvailable(VK_PRESENT_MODE_FIFO_RELAXED_KHR)) {
+        std::cout << "Present mode: V-Sync relaxed" << std::endl;
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+      }
+      break;
+    case PresentModePolicy::kFifo:
+      break;
   }
-  // Immediate == greedy method, no sync needed just present buffers now.
-  // although has higher power consumption and causes tearing.
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
 
   // Using V-sync as fallback if no other present mode is found.
   // FIFO mode == V-sync. Swap chain sync with v-sync of display
-  // to prevent tearing.
+  // to prevent tearing. The only mode the spec requires to be supported.
   std::cout << "Present mode: V-Sync" << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_pipeline.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -11,12 +12,34 @@
 
 namespace lve {
 
+// Requested present mode. Falls back to the closest supported one, FIFO is always available.
+enum class PresentModePolicy {
+  // No sync, uncapped frame rate with tearing. For benchmarks.
+  kImmediate,
+  // Replaces the queued image, no tearing and low latency. Falls back to FIFO.
+  kMailbox,
+  // V-sync.
+  kFifo,
+  // V-sync, but a late frame is presented right away(tears) instead of waiting a full refresh.
+  kFifoRelaxed,
+};
+
+struct SwapChainConfig {
+  // Frames the cpu may record ahead of the gpu. 1 = lowest latency, 3+ = most throughput.
+  uint32_t framesInFlight = 2;
+  // Requested swap chain images, 0 = minImageCount + 1. Clamped to the surface capabilities.
+  uint32_t imageCount = 0;
+  PresentModePolicy presentMode = PresentModePolicy::kMailbox;
+};
+
 class LveSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
+  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, const SwapChainConfig &config = {});
+  LveSwapChain(
+      LveDevice &deviceRef,
+      VkExtent2D windowExtent,
+      std::shared_ptr<LveSwapChain> previous,
+      const SwapChainConfig &config = {});
   ~LveSwapChain();
 
   LveSwapChain(const LveSwapChain &) = delete;
@@ -26,6 +49,8 @@ class LveSwapChain {
   VkRenderPass getRenderPass() { return renderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
   size_t imageCount() { return swapChainImages.size(); }
+  uint32_t framesInFlight() const { return config.framesInFlight; }
+  const SwapChainConfig &getConfig() const { return config; }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
   uint32_t width() { return swapChainExtent.width; }
@@ -36,12 +61,28 @@ class LveSwapChain {
   }
   VkFormat findDepthFormat();
 
-  VkResult acquireNextImage(uint32_t *imageIndex);
-  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+  // Index of the frame in flight used by the next acquireNextImage. Carried over to the next swap
+  // chain together with the sync objects.
+  size_t getCurrentFrame() const { return currentFrame; }
+  // Blocks until every frame submitted through this swap chain has finished on the gpu.
+  void waitForFrames();
 
-  // Check that image and depth format is same to check render pass compatability.
+  VkResult acquireNextImage(uint32_t *imageIndex);
+  // extraWaitSemaphores(e.g compute work of this frame) are waited on next to image availability,
+  // each at the matching stage of extraWaitStages.
+  VkResult submitCommandBuffers(
+      const VkCommandBuffer *buffers,
+      uint32_t *imageIndex,
+      const std::vector<VkSemaphore> &extraWaitSemaphores = {},
+      const std::vector<VkPipelineStageFlags> &extraWaitStages = {});
+
+  RenderPassCompatibility getRenderPassCompatibility() const {
+    return {swapChainImageFormat, swapChainDepthFormat, swapChainSamples};
+  }
+  // Check that image and depth format is same to check render pass compatability. When it is, the
+  // new swap chain reuses the old render pass and pipelines created with it stay valid.
   bool compareSwapFormats(const LveSwapChain& swap_chain) const {
-    return swap_chain.swapChainDepthFormat == swapChainDepthFormat && swap_chain.swapChainImageFormat == swapChainImageFormat;
+    return swap_chain.getRenderPassCompatibility() == getRenderPassCompatibility();
   }
 
  private:
@@ -62,19 +103,21 @@ class LveSwapChain {
 
   VkFormat swapChainImageFormat;
   VkFormat swapChainDepthFormat;
+  VkSampleCountFlagBits swapChainSamples = VK_SAMPLE_COUNT_1_BIT;
   VkExtent2D swapChainExtent;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<LveAllocation> depthImageAllocations;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
   LveDevice &device;
   VkExtent2D windowExtent;
+  SwapChainConfig config;
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<LveSwapChain> oldSwapChain;
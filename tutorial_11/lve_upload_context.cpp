@@ -0,0 +1,508 @@
+#include "lve_upload_context.hpp"
+
+// std headers
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+LveUploadContext::LveUploadContext(LveDevice &device, VkDeviceSize staging_size)
+    : lve_device_{device}, staging_size_{alignUp(staging_size, kStagingAlignment)} {
+  QueueFamilyIndices indices = lve_device_.findPhysicalQueueFamilies();
+  dedicated_transfer_ = indices.hasDedicatedTransfer();
+  transfer_family_ = indices.transferFamily;
+  graphics_family_ = indices.graphicsFamily;
+  queue_ = dedicated_transfer_ ? lve_device_.transferQueue() : lve_device_.graphicsQueue();
+
+  VkCommandPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.queueFamilyIndex = transfer_family_;
+  // Command buffers are recycled batch by batch, so they need to be individually resettable.
+  pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(lve_device_.device(), &pool_info, nullptr, &command_pool_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+  if (dedicated_transfer_) {
+    // Acquire barriers have to be recorded on a queue of the receiving(graphics) family.
+    pool_info.queueFamilyIndex = graphics_family_;
+    if (vkCreateCommandPool(
+            lve_device_.device(), &pool_info, nullptr, &acquire_command_pool_) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload command pool!");
+    }
+  }
+
+  lve_device_.createBuffer(
+      staging_size_,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      staging_buffer_,
+      staging_allocation_);
+}
+
+LveUploadContext::~LveUploadContext() {
+  waitIdle();
+  for (auto &batch : free_batches_) {
+    vkDestroyFence(lve_device_.device(), batch.fence, nullptr);
+    vkDestroySemaphore(lve_device_.device(), batch.transfer_done, nullptr);
+  }
+  // Destroying the pool frees all command buffers allocated from it.
+  vkDestroyCommandPool(lve_device_.device(), command_pool_, nullptr);
+  vkDestroyCommandPool(lve_device_.device(), acquire_command_pool_, nullptr);
+  lve_device_.destroyBuffer(staging_buffer_, staging_allocation_);
+}
+
+VkCommandBuffer LveUploadContext::recordingCommandBuffer() {
+  if (is_recording_) {
+    return recording_.command_buffer;
+  }
+
+  if (!free_batches_.empty()) {
+    recording_ = std::move(free_batches_.back());
+    free_batches_.pop_back();
+  } else {
+    recording_ = Batch{};
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = command_pool_;
+    alloc_info.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, &recording_.command_buffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(lve_device_.device(), &fence_info, nullptr, &recording_.fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload fence!");
+    }
+
+    if (dedicated_transfer_) {
+      alloc_info.commandPool = acquire_command_pool_;
+      if (vkAllocateCommandBuffers(
+              lve_device_.device(), &alloc_info, &recording_.acquire_command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+      }
+      VkSemaphoreCreateInfo semaphore_info{};
+      semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      if (vkCreateSemaphore(
+              lve_device_.device(), &semaphore_info, nullptr, &recording_.transfer_done) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload semaphore!");
+      }
+    }
+  }
+  recording_.ticket = next_ticket_;
+
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(recording_.command_buffer, &begin_info);
+  is_recording_ = true;
+  return recording_.command_buffer;
+}
+
+std::pair<VkBuffer, VkDeviceSize> LveUploadContext::reserveStaging(VkDeviceSize size, void **mapped) {
+  // Too big for the ring, give it a staging buffer of its own that lives as long as the batch.
+  if (size > staging_size_) {
+    VkBuffer buffer;
+    LveAllocation allocation;
+    lve_device_.createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        buffer,
+        allocation);
+    recordingCommandBuffer();
+    recording_.overflow_buffers.emplace_back(buffer, allocation);
+    *mapped = allocation.mapped;
+    return {buffer, 0};
+  }
+
+  VkDeviceSize start = alignUp(ring_head_, kStagingAlignment);
+  // A region can't wrap around the end of the buffer, skip to the start of the buffer instead.
+  if (start % staging_size_ + size > staging_size_) {
+    start = alignUp(start, staging_size_);
+  }
+  // Wait for the oldest batches to retire until there is room.
+  while (start + size - ring_tail_ > staging_size_) {
+    if (!in_flight_.empty()) {
+      retireOldest();
+    } else if (is_recording_ && ring_head_ > ring_tail_) {
+      // Only the batch being recorded holds staging memory, submit it so it can retire.
+      flush();
+    } else {
+      // Nothing holds staging memory anymore.
+      ring_tail_ = start;
+    }
+  }
+  ring_head_ = start + size;
+
+  *mapped = static_cast<char *>(staging_allocation_.mapped) + start % staging_size_;
+  return {staging_buffer_, start % staging_size_};
+}
+
+UploadTicket LveUploadContext::uploadBuffer(
+    VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size) {
+  if (size == 0) {
+    return 0;
+  }
+  void *mapped;
+  auto staging = reserveStaging(size, &mapped);
+  memcpy(mapped, data, static_cast<size_t>(size));
+  return copyBuffer(staging.first, dst_buffer, size, staging.second, dst_offset);
+}
+
+UploadTicket LveUploadContext::uploadImage(
+    VkImage image,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layer_count,
+    const void *data,
+    VkDeviceSize size,
+    VkImageLayout final_layout) {
+  void *mapped;
+  auto staging = reserveStaging(size, &mapped);
+  memcpy(mapped, data, static_cast<size_t>(size));
+  VkCommandBuffer command_buffer = recordingCommandBuffer();
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layer_count;
+
+  // Old content is discarded(UNDEFINED), image only has to be ready to be written by the copy.
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = staging.second;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layer_count;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(
+      command_buffer,
+      staging.first,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+
+  if (dedicated_transfer_) {
+    // The layout transition happens as part of the ownership transfer.
+    releaseImage(image, layer_count, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout);
+    return recording_.ticket;
+  }
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = final_layout;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+  return recording_.ticket;
+}
+
+UploadTicket LveUploadContext::copyBuffer(
+    VkBuffer src_buffer,
+    VkBuffer dst_buffer,
+    VkDeviceSize size,
+    VkDeviceSize src_offset,
+    VkDeviceSize dst_offset) {
+  // A zero sized region is invalid in vkCmdCopyBuffer.
+  if (size == 0) {
+    return 0;
+  }
+  VkCommandBuffer command_buffer = recordingCommandBuffer();
+  VkBufferCopy copy_region{};
+  copy_region.srcOffset = src_offset;
+  copy_region.dstOffset = dst_offset;
+  copy_region.size = size;
+  vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+  if (dedicated_transfer_) {
+    releaseBuffer(dst_buffer, dst_offset, size);
+  }
+  return recording_.ticket;
+}
+
+UploadTicket LveUploadContext::copyBufferToImage(
+    VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layer_count) {
+  VkCommandBuffer command_buffer = recordingCommandBuffer();
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layer_count;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(
+      command_buffer,
+      buffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+  if (dedicated_transfer_) {
+    releaseImage(
+        image, layer_count, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  }
+  return recording_.ticket;
+}
+
+void LveUploadContext::releaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.srcQueueFamilyIndex = transfer_family_;
+  barrier.dstQueueFamilyIndex = graphics_family_;
+  barrier.buffer = buffer;
+  barrier.offset = offset;
+  barrier.size = size;
+  recording_.buffer_releases.push_back(barrier);
+}
+
+void LveUploadContext::releaseImage(
+    VkImage image, uint32_t layer_count, VkImageLayout old_layout, VkImageLayout new_layout) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = transfer_family_;
+  barrier.dstQueueFamilyIndex = graphics_family_;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layer_count;
+  recording_.image_releases.push_back(barrier);
+}
+
+// Queue family ownership transfer: the transfer queue releases every written resource, and the
+// graphics queue acquires them once the transfer_done semaphore is signaled. Both halves must
+// use identical barriers(apart from the access masks), which is why they are collected first.
+void LveUploadContext::submitDedicated() {
+  vkCmdPipelineBarrier(
+      recording_.command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(recording_.buffer_releases.size()),
+      recording_.buffer_releases.data(),
+      static_cast<uint32_t>(recording_.image_releases.size()),
+      recording_.image_releases.data());
+  vkEndCommandBuffer(recording_.command_buffer);
+
+  for (auto &barrier : recording_.buffer_releases) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  }
+  for (auto &barrier : recording_.image_releases) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  }
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(recording_.acquire_command_buffer, &begin_info);
+  vkCmdPipelineBarrier(
+      recording_.acquire_command_buffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(recording_.buffer_releases.size()),
+      recording_.buffer_releases.data(),
+      static_cast<uint32_t>(recording_.image_releases.size()),
+      recording_.image_releases.data());
+  vkEndCommandBuffer(recording_.acquire_command_buffer);
+
+  VkSubmitInfo transfer_submit{};
+  transfer_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  transfer_submit.commandBufferCount = 1;
+  transfer_submit.pCommandBuffers = &recording_.command_buffer;
+  transfer_submit.signalSemaphoreCount = 1;
+  transfer_submit.pSignalSemaphores = &recording_.transfer_done;
+  if (vkQueueSubmit(queue_, 1, &transfer_submit, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSubmitInfo acquire_submit{};
+  acquire_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquire_submit.waitSemaphoreCount = 1;
+  acquire_submit.pWaitSemaphores = &recording_.transfer_done;
+  acquire_submit.pWaitDstStageMask = &wait_stage;
+  acquire_submit.commandBufferCount = 1;
+  acquire_submit.pCommandBuffers = &recording_.acquire_command_buffer;
+  // Fence on the graphics side, once it signals the data is both copied and owned by graphics.
+  if (vkQueueSubmit(lve_device_.graphicsQueue(), 1, &acquire_submit, recording_.fence) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload acquire command buffer!");
+  }
+  recording_.buffer_releases.clear();
+  recording_.image_releases.clear();
+}
+
+UploadTicket LveUploadContext::flush() {
+  if (!is_recording_) {
+    return next_ticket_ - 1;
+  }
+
+  if (dedicated_transfer_) {
+    submitDedicated();
+  } else {
+    submitShared();
+  }
+
+  recording_.ring_end = ring_head_;
+  UploadTicket ticket = recording_.ticket;
+  in_flight_.push_back(std::move(recording_));
+  recording_ = Batch{};
+  is_recording_ = false;
+  next_ticket_++;
+  return ticket;
+}
+
+void LveUploadContext::submitShared() {
+  // Make the copies visible to whatever gets submitted to the queue afterwards
+  // (vertex fetch, index fetch, shader reads), so callers don't need barriers of their own.
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  vkCmdPipelineBarrier(
+      recording_.command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+  vkEndCommandBuffer(recording_.command_buffer);
+
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &recording_.command_buffer;
+  // Fence instead of vkQueueWaitIdle, the host only waits when(and if) someone needs the result.
+  if (vkQueueSubmit(queue_, 1, &submit_info, recording_.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+}
+
+void LveUploadContext::retire(Batch &batch) {
+  for (auto &overflow : batch.overflow_buffers) {
+    lve_device_.destroyBuffer(overflow.first, overflow.second);
+  }
+  batch.overflow_buffers.clear();
+  completed_ticket_ = batch.ticket;
+  ring_tail_ = batch.ring_end;
+
+  vkResetFences(lve_device_.device(), 1, &batch.fence);
+  vkResetCommandBuffer(batch.command_buffer, 0);
+  if (batch.acquire_command_buffer != VK_NULL_HANDLE) {
+    vkResetCommandBuffer(batch.acquire_command_buffer, 0);
+  }
+  free_batches_.push_back(std::move(batch));
+}
+
+void LveUploadContext::retireOldest() {
+  Batch &oldest = in_flight_.front();
+  vkWaitForFences(
+      lve_device_.device(), 1, &oldest.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+  retire(oldest);
+  in_flight_.pop_front();
+}
+
+void LveUploadContext::retireCompleted() {
+  // Batches complete in submission order, stop at the first one still running.
+  while (!in_flight_.empty() &&
+         vkGetFenceStatus(lve_device_.device(), in_flight_.front().fence) == VK_SUCCESS) {
+    retire(in_flight_.front());
+    in_flight_.pop_front();
+  }
+}
+
+void LveUploadContext::submit(UploadTicket ticket) {
+  // Shared queue: submitShared's barrier covers all later commands. Dedicated transfer queue: the
+  // acquire barriers are submitted to the graphics queue, ahead of anything submitted after.
+  if (is_recording_ && ticket >= recording_.ticket) {
+    flush();
+  }
+}
+
+bool LveUploadContext::isComplete(UploadTicket ticket) {
+  retireCompleted();
+  return ticket <= completed_ticket_;
+}
+
+void LveUploadContext::wait(UploadTicket ticket) {
+  if (is_recording_ && ticket >= recording_.ticket) {
+    flush();
+  }
+  while (completed_ticket_ < ticket && !in_flight_.empty()) {
+    retireOldest();
+  }
+}
+
+void LveUploadContext::waitIdle() {
+  flush();
+  while (!in_flight_.empty()) {
+    retireOldest();
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std lib headers
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+// Batches host->device uploads into as few queue submissions as possible.
+// Data is written into a persistently mapped staging ring buffer and the copies are recorded
+// into one command buffer, which is only submitted on flush() (or when the ring runs full).
+// Every call returns the ticket of the batch it was recorded into, callers poll(isComplete)
+// or block(wait) on it, instead of waiting for the whole queue after each copy. Copies of 0 bytes
+// record nothing and return ticket 0, which is always complete.
+// When the device has a dedicated transfer family, batches run on the transfer queue, and the
+// written buffers/images are handed over to the graphics family(queue family ownership transfer)
+// so streaming doesn't take time away from rendering on the graphics queue.
+// Not thread safe, upload from one thread at a time.
+class LveUploadContext {
+ public:
+  static constexpr VkDeviceSize kDefaultStagingSize = 16ull * 1024 * 1024;
+  // Keeps every staging offset valid for both buffer copies and image copies of any texel size.
+  static constexpr VkDeviceSize kStagingAlignment = 16;
+
+  LveUploadContext(LveDevice &device, VkDeviceSize staging_size = kDefaultStagingSize);
+  ~LveUploadContext();
+
+  LveUploadContext(const LveUploadContext &) = delete;
+  LveUploadContext &operator=(const LveUploadContext &) = delete;
+
+  // Copy `size` bytes of host memory into dst_buffer at dst_offset.
+  UploadTicket uploadBuffer(
+      VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+  // Copy tightly packed texels into mip 0 of image, and transition it from undefined to final_layout.
+  UploadTicket uploadImage(
+      VkImage image,
+      uint32_t width,
+      uint32_t height,
+      uint32_t layer_count,
+      const void *data,
+      VkDeviceSize size,
+      VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  // Device to device copies, recorded in the same batch as the uploads.
+  UploadTicket copyBuffer(
+      VkBuffer src_buffer,
+      VkBuffer dst_buffer,
+      VkDeviceSize size,
+      VkDeviceSize src_offset = 0,
+      VkDeviceSize dst_offset = 0);
+  // Image has to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL already.
+  // With a dedicated transfer queue, src_buffer/buffer must not be owned by another queue family.
+  UploadTicket copyBufferToImage(
+      VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layer_count);
+
+  // Submit everything recorded so far with a single vkQueueSubmit.
+  // Returns the ticket of the submitted batch(or of the last batch, if nothing was recorded).
+  UploadTicket flush();
+  // Flushes if ticket's batch is still recording, without waiting. Enough before using the data on
+  // the graphics queue: work submitted there afterwards is ordered after the upload on the GPU.
+  void submit(UploadTicket ticket);
+  bool isComplete(UploadTicket ticket);
+  // Blocks until the batch of ticket finished on the GPU. Flushes first if it's still recording.
+  void wait(UploadTicket ticket);
+  void waitIdle();
+
+ private:
+  struct Batch {
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    // Only used with a dedicated transfer queue: graphics queue command buffer acquiring ownership
+    // of everything written, and the semaphore it waits on.
+    VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE;
+    VkSemaphore transfer_done = VK_NULL_HANDLE;
+    std::vector<VkBufferMemoryBarrier> buffer_releases;
+    std::vector<VkImageMemoryBarrier> image_releases;
+    UploadTicket ticket = 0;
+    // Ring head when the batch was submitted, the ring tail moves here once it retires.
+    VkDeviceSize ring_end = 0;
+    // One-off staging buffers for uploads that don't fit in the ring.
+    std::vector<std::pair<VkBuffer, LveAllocation>> overflow_buffers;
+  };
+
+  // Returns the command buffer of the batch currently being recorded, starting one if needed.
+  VkCommandBuffer recordingCommandBuffer();
+  // Reserves `size` bytes of staging memory, returns buffer + offset to write to.
+  std::pair<VkBuffer, VkDeviceSize> reserveStaging(VkDeviceSize size, void **mapped);
+  // Hand dst over to the graphics family once the batch is done(dedicated transfer queue only).
+  void releaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+  void releaseImage(
+      VkImage image, uint32_t layer_count, VkImageLayout old_layout, VkImageLayout new_layout);
+  void submitShared();
+  void submitDedicated();
+  void retireCompleted();
+  void retireOldest();
+  void retire(Batch &batch);
+
+  LveDevice &lve_device_;
+  bool dedicated_transfer_;
+  uint32_t transfer_family_;
+  uint32_t graphics_family_;
+  VkQueue queue_;
+  VkCommandPool command_pool_;
+  VkCommandPool acquire_command_pool_ = VK_NULL_HANDLE;
+
+  // Ring buffer, head and tail are monotonic byte counters. offset in buffer = counter % size.
+  VkBuffer staging_buffer_;
+  LveAllocation staging_allocation_;
+  VkDeviceSize staging_size_;
+  VkDeviceSize ring_head_ = 0;
+  VkDeviceSize ring_tail_ = 0;
+
+  Batch recording_;
+  bool is_recording_ = false;
+  std::deque<Batch> in_flight_;
+  // Command buffer + fence pairs of retired batches, ready to be reused.
+  std::vector<Batch> free_batches_;
+  UploadTicket next_ticket_ = 1;
+  UploadTicket completed_ticket_ = 0;
+};
+
+}  // namespace lve
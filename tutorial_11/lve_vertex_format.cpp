@@ -0,0 +1,125 @@
+#include "lve_vertex_format.hpp"
+
+// std headers
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+int16_t packSnorm16(float value) {
+  return static_cast<int16_t>(std::lrint(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+uint8_t packUnorm8(float value) {
+  return static_cast<uint8_t>(std::lrint(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+uint16_t packHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t float_exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+  if (float_exponent == 0xff) {
+    // Infinity stays infinity, NaN stays a(quiet) NaN.
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+  }
+  int32_t exponent = static_cast<int32_t>(float_exponent) - 127 + 15;
+  if (exponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+  if (exponent <= 0) {
+    // Denormal half, or zero when even that is too small.
+    if (exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000;
+    uint32_t shift = static_cast<uint32_t>(14 - exponent);
+    uint32_t half = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fff;
+  // A carry out of the mantissa correctly bumps the exponent(up to infinity).
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+}  // namespace
+
+void packSnorm16(const float *values, size_t count, int16_t *out) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 min = _mm_set1_ps(-1.0f);
+  const __m128 max = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(32767.0f);
+  for (; i + 8 <= count; i += 8) {
+    __m128 low = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), min), max), scale);
+    __m128 high = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 4), min), max), scale);
+    // cvtps rounds to nearest even, packs can't saturate since the values are in range.
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = packSnorm16(values[i]);
+  }
+}
+
+void packUnorm8(const float *values, size_t count, uint8_t *out) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 min = _mm_setzero_ps();
+  const __m128 max = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  auto convert = [&](const float *source) {
+    return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source), min), max), scale));
+  };
+  for (; i + 16 <= count; i += 16) {
+    __m128i low = _mm_packs_epi32(convert(values + i), convert(values + i + 4));
+    __m128i high = _mm_packs_epi32(convert(values + i + 8), convert(values + i + 12));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(low, high));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = packUnorm8(values[i]);
+  }
+}
+
+void packHalf(const float *values, size_t count, uint16_t *out) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = packHalf(values[i]);
+  }
+}
+
+Snorm16x2 packOctahedralSnorm16(float x, float y, float z) {
+  float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+  if (length == 0.0f) {
+    return {0, 0};
+  }
+  x /= length;
+  y /= length;
+  if (z < 0.0f) {
+    float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = folded_x;
+    y = folded_y;
+  }
+  return {packSnorm16(x), packSnorm16(y)};
+}
+
+}  // namespace lve
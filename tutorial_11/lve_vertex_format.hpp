@@ -0,0 +1,101 @@
+#pragma once
+
+// std lib headers
+#include <cstddef>
+#include <cstdint>
+
+namespace lve {
+
+// Packed vertex components, each maps to one VkFormat(see VertexAttributeFormat).
+// SNORM/UNORM are read by the shader as floats in [-1, 1] / [0, 1], so shaders don't change.
+struct Snorm16x2 {  // VK_FORMAT_R16G16_SNORM
+  int16_t x, y;
+};
+struct Half2 {  // VK_FORMAT_R16G16_SFLOAT
+  uint16_t x, y;
+};
+struct Unorm8x4 {  // VK_FORMAT_R8G8B8A8_UNORM
+  uint8_t r, g, b, a;
+};
+
+// Layout of the vertices in a vertex buffer. LveModel::Builder keeps float vertices, models
+// encode them into this format on upload.
+enum class VertexFormat {
+  // LveModel::Vertex as is, 20 bytes.
+  kFloat32,
+  // PackedVertex2D, 8 bytes. Positions must be in [-1, 1], scale them with the transform.
+  kSnorm16,
+  // HalfVertex2D, 8 bytes. Any range, ~3 significant digits.
+  kHalf,
+};
+
+// How the vertex attributes are spread over vertex buffer bindings.
+enum class VertexStreams {
+  // One binding, position and color of a vertex next to each other.
+  kInterleaved,
+  // Binding 0 holds only positions, binding 1 the other attributes. Depth-only, shadow and
+  // picking passes bind just binding 0 and fetch 4-8 instead of 8-20 bytes per vertex.
+  kSplit,
+};
+
+struct PackedVertex2D {
+  Snorm16x2 position;
+  Unorm8x4 color;
+};
+struct HalfVertex2D {
+  Half2 position;
+  Unorm8x4 color;
+};
+
+// Streams of VertexStreams::kSplit, the interleaved vertex of a format cut after the position.
+struct PositionStream2D {  // kFloat32
+  float position[2];
+};
+struct PackedPositionStream2D {  // kSnorm16
+  Snorm16x2 position;
+};
+struct HalfPositionStream2D {  // kHalf
+  Half2 position;
+};
+struct AttributeStream2D {  // kFloat32
+  float color[3];
+};
+struct PackedAttributeStream2D {  // kSnorm16, kHalf
+  Unorm8x4 color;
+};
+
+// Bytes per vertex of binding 0 / binding 1 of VertexStreams::kSplit.
+constexpr uint32_t positionStreamStride(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::kSnorm16:
+      return sizeof(PackedPositionStream2D);
+    case VertexFormat::kHalf:
+      return sizeof(HalfPositionStream2D);
+    case VertexFormat::kFloat32:
+    default:
+      return sizeof(PositionStream2D);
+  }
+}
+constexpr uint32_t attributeStreamStride(VertexFormat format) {
+  return format == VertexFormat::kFloat32 ? sizeof(AttributeStream2D) : sizeof(PackedAttributeStream2D);
+}
+// Bytes per vertex of format, the two streams back to back. lve_vertex_layout.hpp and
+// lve_model.hpp check it against the interleaved layouts.
+constexpr uint32_t vertexStride(VertexFormat format) {
+  return positionStreamStride(format) + attributeStreamStride(format);
+}
+
+// Batch encoders, count values from values into out. SSE2 for snorm/unorm when available, scalar
+// otherwise and for half floats. All round to nearest even.
+// Clamped to [-1, 1], scaled by 32767.
+void packSnorm16(const float *values, size_t count, int16_t *out);
+// Clamped to [0, 1], scaled by 255.
+void packUnorm8(const float *values, size_t count, uint8_t *out);
+// IEEE half, overflow becomes infinity.
+void packHalf(const float *values, size_t count, uint16_t *out);
+
+// Unit vector(e.g a normal) to 2 components: projected onto the octahedron |x|+|y|+|z| = 1, the
+// lower half folded over the upper one. ~0.005 degrees of error at 16 bits. A zero vector is (0, 0).
+Snorm16x2 packOctahedralSnorm16(float x, float y, float z);
+
+}  // namespace lve
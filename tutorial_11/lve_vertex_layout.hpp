@@ -0,0 +1,122 @@
+#pragma once
+
+#include "lve_vertex_format.hpp"
+
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// VkFormat a vertex shader input of type T is read with. Specialize for new component types.
+template <typename T>
+struct VertexAttributeFormat;
+
+template <VkFormat kFormat>
+struct VertexAttributeFormatIs {
+  static constexpr VkFormat value = kFormat;
+};
+template <> struct VertexAttributeFormat<float> : VertexAttributeFormatIs<VK_FORMAT_R32_SFLOAT> {};
+template <> struct VertexAttributeFormat<float[2]> : VertexAttributeFormatIs<VK_FORMAT_R32G32_SFLOAT> {};
+template <> struct VertexAttributeFormat<float[3]> : VertexAttributeFormatIs<VK_FORMAT_R32G32B32_SFLOAT> {};
+template <> struct VertexAttributeFormat<uint32_t> : VertexAttributeFormatIs<VK_FORMAT_R32_UINT> {};
+template <> struct VertexAttributeFormat<int32_t> : VertexAttributeFormatIs<VK_FORMAT_R32_SINT> {};
+template <> struct VertexAttributeFormat<Snorm16x2> : VertexAttributeFormatIs<VK_FORMAT_R16G16_SNORM> {};
+template <> struct VertexAttributeFormat<Half2> : VertexAttributeFormatIs<VK_FORMAT_R16G16_SFLOAT> {};
+template <> struct VertexAttributeFormat<Unorm8x4> : VertexAttributeFormatIs<VK_FORMAT_R8G8B8A8_UNORM> {};
+
+// One member of a vertex struct, see LVE_VERTEX_FIELD.
+struct VertexField {
+  VkFormat format;
+  uint32_t offset;
+};
+
+// Format and offset of Vertex::member, both derived from the struct so they can't go out of sync.
+#define LVE_VERTEX_FIELD(Vertex, member)                                               \
+  ::lve::VertexField {                                                                 \
+    ::lve::VertexAttributeFormat<decltype(Vertex::member)>::value,                     \
+        static_cast<uint32_t>(offsetof(Vertex, member))                                \
+  }
+
+// Binding + attribute descriptions of one vertex buffer binding, computed at compile time.
+template <size_t kAttributeCount>
+struct VertexLayout {
+  VkVertexInputBindingDescription binding;
+  std::array<VkVertexInputAttributeDescription, kAttributeCount> attributes;
+};
+
+// Attribute i gets location first_location + i, so fields are listed in shader location order.
+template <typename Vertex, typename... Fields>
+constexpr VertexLayout<sizeof...(Fields)> makeVertexLayout(
+    uint32_t binding, uint32_t first_location, Fields... fields) {
+  VertexLayout<sizeof...(Fields)> layout{};
+  layout.binding.binding = binding;
+  layout.binding.stride = static_cast<uint32_t>(sizeof(Vertex));
+  layout.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  const VertexField field_list[] = {fields...};
+  for (uint32_t i = 0; i < sizeof...(Fields); i++) {
+    layout.attributes[i].location = first_location + i;
+    layout.attributes[i].binding = binding;
+    layout.attributes[i].format = field_list[i].format;
+    layout.attributes[i].offset = field_list[i].offset;
+  }
+  return layout;
+}
+
+// Vertex input descriptions of a set of layouts, one per binding, e.g for PipelineConfigInfo.
+template <size_t... kAttributeCounts>
+std::vector<VkVertexInputBindingDescription> vertexBindingDescriptions(
+    const VertexLayout<kAttributeCounts> &...layouts) {
+  return {layouts.binding...};
+}
+template <size_t... kAttributeCounts>
+std::vector<VkVertexInputAttributeDescription> vertexAttributeDescriptions(
+    const VertexLayout<kAttributeCounts> &...layouts) {
+  std::vector<VkVertexInputAttributeDescription> attributes;
+  attributes.reserve((kAttributeCounts + ... + 0));
+  (attributes.insert(attributes.end(), layouts.attributes.begin(), layouts.attributes.end()), ...);
+  return attributes;
+}
+
+// Layouts of the packed vertex structs, position at location 0 like LveModel::Vertex.
+inline constexpr auto kPackedVertex2DLayout = makeVertexLayout<PackedVertex2D>(
+    /*binding*/ 0,
+    /*first_location*/ 0,
+    LVE_VERTEX_FIELD(PackedVertex2D, position),
+    LVE_VERTEX_FIELD(PackedVertex2D, color));
+inline constexpr auto kHalfVertex2DLayout = makeVertexLayout<HalfVertex2D>(
+    /*binding*/ 0,
+    /*first_location*/ 0,
+    LVE_VERTEX_FIELD(HalfVertex2D, position),
+    LVE_VERTEX_FIELD(HalfVertex2D, color));
+
+// Layouts of VertexStreams::kSplit. Locations match the interleaved layouts, so shaders don't
+// change. Depth-only pipelines use just the position layout.
+inline constexpr auto kPositionStream2DLayout = makeVertexLayout<PositionStream2D>(
+    /*binding*/ 0, /*first_location*/ 0, LVE_VERTEX_FIELD(PositionStream2D, position));
+inline constexpr auto kPackedPositionStream2DLayout = makeVertexLayout<PackedPositionStream2D>(
+    /*binding*/ 0, /*first_location*/ 0, LVE_VERTEX_FIELD(PackedPositionStream2D, position));
+inline constexpr auto kHalfPositionStream2DLayout = makeVertexLayout<HalfPositionStream2D>(
+    /*binding*/ 0, /*first_location*/ 0, LVE_VERTEX_FIELD(HalfPositionStream2D, position));
+inline constexpr auto kAttributeStream2DLayout = makeVertexLayout<AttributeStream2D>(
+    /*binding*/ 1, /*first_location*/ 1, LVE_VERTEX_FIELD(AttributeStream2D, color));
+inline constexpr auto kPackedAttributeStream2DLayout = makeVertexLayout<PackedAttributeStream2D>(
+    /*binding*/ 1, /*first_location*/ 1, LVE_VERTEX_FIELD(PackedAttributeStream2D, color));
+
+// The strides buffers are encoded with(lve_vertex_format.hpp) must be the layouts' strides.
+static_assert(vertexStride(VertexFormat::kSnorm16) == kPackedVertex2DLayout.binding.stride &&
+                  vertexStride(VertexFormat::kHalf) == kHalfVertex2DLayout.binding.stride,
+              "Packed vertex strides don't match their layouts.");
+static_assert(positionStreamStride(VertexFormat::kFloat32) == kPositionStream2DLayout.binding.stride &&
+                  positionStreamStride(VertexFormat::kSnorm16) == kPackedPositionStream2DLayout.binding.stride &&
+                  positionStreamStride(VertexFormat::kHalf) == kHalfPositionStream2DLayout.binding.stride &&
+                  attributeStreamStride(VertexFormat::kFloat32) == kAttributeStream2DLayout.binding.stride &&
+                  attributeStreamStride(VertexFormat::kSnorm16) == kPackedAttributeStream2DLayout.binding.stride &&
+                  attributeStreamStride(VertexFormat::kHalf) == kPackedAttributeStream2DLayout.binding.stride,
+              "Split stream strides don't match their layouts.");
+
+}  // namespace lve
@@ -1,11 +1,34 @@
 #include "first_app.hpp"
+#include "headless_app.hpp"
 #include "sierpinski_app.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+
+// Usage: a.out [--headless [frame count] [output.ppm]]
+int runHeadless(int argc, char **argv) {
+  int frame_count = argc > 2 ? std::atoi(argv[2]) : 1000;
+  std::string output_path = argc > 3 ? argv[3] : "";
+  try {
+    lve::HeadlessApp app{frame_count, output_path};
+    app.init();
+    app.run();
+  } catch(const std::exception &e) {
+    std::cerr << e.what() <<"\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  // No window/surface, renders offscreen. For CI and benchmarking without a display.
+  if (argc > 1 && std::strcmp(argv[1], "--headless") == 0) {
+    return runHeadless(argc, argv);
+  }
 
-int main() {
   /* Uncomment below to run vanilla first_app */
   lve::FirstApp app;
   /* Uncomment above to run vanilla first_app */
@@ -24,4 +47,4 @@ int main() {
     return EXIT_FAILURE;
   }
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -9,6 +9,10 @@
 // [out] qualifier specifies that the variable is going tobe used as an output of this fn.
 // with type "vec4" and name "outColor".
 layout (location = 0) out vec4 outColor;
+layout(location = 0) in vec3 fragColor;
+
+// 0 = color from push constant(per object), 1 = interpolated vertex color.
+layout(constant_id = 0) const int COLOR_MODE = 0;
 layout(push_constant) uniform Push {
     mat2 transform;
     vec2 offset;
@@ -21,5 +25,5 @@ void main() {
     // vertices position -> [Rasterization] -> pixels/fragments inside geometry.
     // R,G,B,Alpha(opaqueness), [0.0-1.0] value range.
     // Can initialize vec4 with vec4(vec3, float).
-    outColor = vec4(push.color, 1.0);
+    outColor = vec4(COLOR_MODE == 1 ? fragColor : push.color, 1.0);
 }
\ No newline at end of file
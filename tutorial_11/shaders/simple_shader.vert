@@ -5,6 +5,12 @@
 // layout location define where value will come from within storage.
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec3 inColor;
+
+// Specialization constants, set per pipeline variant(SimpleShaderConstants). Branches on them are
+// resolved when the pipeline is compiled, they cost nothing per vertex.
+layout(constant_id = 1) const bool APPLY_TRANSFORM = true;
+
+layout(location = 0) out vec3 fragColor;
 // Going to get executed for each vertex we have.
 // INPUT: get vertex from inpupt assembler stage.
 layout(push_constant) uniform Push {
@@ -18,5 +24,7 @@ void main() {
     // gl_Position is 4d vector that map to output buffer frame img.
     // Z-axis = layer level, ranges from 0(most front) to 1(most back).
     // norm = normalization/divide the rest of the values by the normalization value.
-    gl_Position = vec4(push.transform * position + push.offset, /*Z-axis*/ 0.0, /*norm*/ 1.0);
+    vec2 transformed = APPLY_TRANSFORM ? push.transform * position : position;
+    gl_Position = vec4(transformed + push.offset, /*Z-axis*/ 0.0, /*norm*/ 1.0);
+    fragColor = inColor;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "simple_compute_system.hpp"
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+static constexpr const char *kCompShaderPath = "shaders/simple_compute.comp.spv";
+// local_size_x of simple_compute.comp.
+static constexpr uint32_t kWorkgroupSize = 64;
+
+// Specialization constants of simple_compute.comp, field i is `layout(constant_id = i)`.
+struct SimpleComputeConstants {
+  uint32_t vertexFormat;
+};
+static_assert(static_cast<uint32_t>(VertexFormat::kFloat32) == 0 && static_cast<uint32_t>(VertexFormat::kSnorm16) == 1 &&
+                  static_cast<uint32_t>(VertexFormat::kHalf) == 2,
+              "simple_compute.comp's VERTEX_FORMAT values.");
+
+struct SimpleComputePushConstantData {
+  float time;
+  uint32_t vertexCount;
+};
+
+SimpleComputeSystem::SimpleComputeSystem(LveDevice &device,
+                                         uint32_t frames_in_flight,
+                                         VertexFormat vertex_format,
+                                         uint32_t triangle_count)
+    : lve_device_(device) {
+  for (uint32_t i = 0; i < frames_in_flight; i++) {
+    models_.push_back(std::make_shared<LveModel>(lve_device_, 3 * triangle_count, vertex_format));
+  }
+  CreateDescriptorSets();
+  CreatePipelineLayout();
+  // The shader writes the layout of the format, the graphics side needs no conversion.
+  SpecializationConstants specialization{};
+  specialization.set(SimpleComputeConstants{static_cast<uint32_t>(vertex_format)});
+  lve_compute_pipeline_ =
+      std::make_unique<LveComputePipeline>(lve_device_, kCompShaderPath, pipeline_layout_, specialization);
+}
+
+SimpleComputeSystem::~SimpleComputeSystem() {
+  lve_compute_pipeline_.reset();
+  vkDestroyPipelineLayout(lve_device_.device(), pipeline_layout_, /*alloc callback*/ nullptr);
+  // Frees the sets allocated from it too.
+  vkDestroyDescriptorPool(lve_device_.device(), descriptor_pool_, /*alloc callback*/ nullptr);
+  vkDestroyDescriptorSetLayout(lve_device_.device(), descriptor_set_layout_, /*alloc callback*/ nullptr);
+}
+
+void SimpleComputeSystem::CreateDescriptorSets() {
+  VkDescriptorSetLayoutBinding vertices_binding{};
+  vertices_binding.binding = 0;
+  vertices_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  vertices_binding.descriptorCount = 1;
+  vertices_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = 1;
+  layout_info.pBindings = &vertices_binding;
+  if (vkCreateDescriptorSetLayout(lve_device_.device(), &layout_info, nullptr, &descriptor_set_layout_) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create descriptor set layout.");
+  }
+
+  VkDescriptorPoolSize pool_size{};
+  pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  pool_size.descriptorCount = static_cast<uint32_t>(models_.size());
+  VkDescriptorPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = static_cast<uint32_t>(models_.size());
+  pool_info.poolSizeCount = 1;
+  pool_info.pPoolSizes = &pool_size;
+  if (vkCreateDescriptorPool(lve_device_.device(), &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create descriptor pool.");
+  }
+
+  std::vector<VkDescriptorSetLayout> set_layouts(models_.size(), descriptor_set_layout_);
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorPool = descriptor_pool_;
+  alloc_info.descriptorSetCount = static_cast<uint32_t>(set_layouts.size());
+  alloc_info.pSetLayouts = set_layouts.data();
+  descriptor_sets_.resize(models_.size());
+  if (vkAllocateDescriptorSets(lve_device_.device(), &alloc_info, descriptor_sets_.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate descriptor sets.");
+  }
+
+  for (size_t i = 0; i < models_.size(); i++) {
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = models_[i]->vertexBuffer();
+    buffer_info.offset = 0;
+    buffer_info.range = VK_WHOLE_SIZE;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_sets_[i];
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &buffer_info;
+    vkUpdateDescriptorSets(lve_device_.device(), 1, &write, 0, nullptr);
+  }
+}
+
+void SimpleComputeSystem::CreatePipelineLayout() {
+  VkPushConstantRange push_constant_range{};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push_constant_range.offset = 0;
+  push_constant_range.size = sizeof(SimpleComputePushConstantData);
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  // Set 0 is the vertex buffer being written.
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &descriptor_set_layout_;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+  if(vkCreatePipelineLayout(lve_device_.device(), &pipeline_layout_info, /*alloc callback*/ nullptr, &pipeline_layout_) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute pipeline layout.");
+  }
+}
+
+void SimpleComputeSystem::Dispatch(VkCommandBuffer compute_command_buffer, int frame_index, float time) {
+  assert(frame_index >= 0 && frame_index < static_cast<int>(models_.size()) &&
+         "Frame index out of the frames in flight the system was created for.");
+  lve_compute_pipeline_->bind(compute_command_buffer);
+  vkCmdBindDescriptorSets(compute_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_,
+                          /*first set*/ 0, /*set count*/ 1, &descriptor_sets_[frame_index],
+                          /*dynamic offset count*/ 0, nullptr);
+  SimpleComputePushConstantData push_constant_data{};
+  push_constant_data.time = time;
+  push_constant_data.vertexCount = models_[frame_index]->vertexCount();
+  vkCmdPushConstants(compute_command_buffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT,
+                     /*offset*/ 0, /*size*/ sizeof(SimpleComputePushConstantData), &push_constant_data);
+  // One invocation per vertex.
+  lve_compute_pipeline_->dispatch(compute_command_buffer,
+                                  (push_constant_data.vertexCount + kWorkgroupSize - 1) / kWorkgroupSize);
+}
+
+}  // namespace lve
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "lve_compute_pipeline.hpp"
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace lve {
+// Writes the vertices of a ring of triangles with a compute shader(simple_compute.comp) every
+// frame, the frame's graphics submission draws them. Exercises the compute queue and the
+// semaphore hand-off of LveRenderer/LveOffscreenRenderer::beginCompute/endCompute.
+// One model per frame in flight, compute of the next frame writes while the last one is drawn.
+class SimpleComputeSystem {
+  public:
+    // triangle_count triangles in vertex_format, draw them with a pipeline for the same format.
+    SimpleComputeSystem(LveDevice &device,
+                        uint32_t frames_in_flight,
+                        VertexFormat vertex_format,
+                        uint32_t triangle_count = 12);
+    ~SimpleComputeSystem();
+    SimpleComputeSystem(const SimpleComputeSystem &) = delete;
+    SimpleComputeSystem &operator=(const SimpleComputeSystem &) = delete;
+
+    // Records the dispatch writing frame_index's model for time(seconds) into compute_command_buffer.
+    void Dispatch(VkCommandBuffer compute_command_buffer, int frame_index, float time);
+    // Model written by Dispatch for frame_index, draw it after endCompute of the same frame.
+    std::shared_ptr<LveModel> GetModel(int frame_index) const { return models_[frame_index]; }
+
+  protected:
+    void CreateDescriptorSets();
+    void CreatePipelineLayout();
+
+    LveDevice& lve_device_;
+    std::vector<std::shared_ptr<LveModel>> models_;
+    VkDescriptorSetLayout descriptor_set_layout_;
+    VkDescriptorPool descriptor_pool_;
+    // One per model, binding 0 is its vertex buffer.
+    std::vector<VkDescriptorSet> descriptor_sets_;
+    VkPipelineLayout pipeline_layout_;
+    std::unique_ptr<LveComputePipeline> lve_compute_pipeline_;
+};
+
+}  // namespace lve
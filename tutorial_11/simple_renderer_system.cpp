@@ -1,17 +1,29 @@
 #include "simple_renderer_system.hpp"
+#include "lve_pipeline_registry.hpp"
 #include <stdexcept>
 #include <array>
 #include <glm/gtc/constants.hpp>
 
 namespace lve {
 
+static constexpr const char *kVertShaderPath = "shaders/simple_shader.vert.spv";
+static constexpr const char *kFragShaderPath = "shaders/simple_shader.frag.spv";
+
 struct SimplePushConstantData {
   glm::mat2 transform;
   alignas(8) glm::vec2 offset;
   alignas(16) glm::vec3 color;
 };
 
-SimpleRendererSystem::SimpleRendererSystem(LveDevice &device, VkRenderPass render_pass) : lve_device_(device) {
+SimpleRendererSystem::SimpleRendererSystem(LveDevice &device,
+                                           VkRenderPass render_pass,
+                                           const RenderPassCompatibility &compatibility,
+                                           VertexFormat vertex_format,
+                                           VertexStreams vertex_streams)
+    : lve_device_(device),
+      render_pass_compatibility_(compatibility),
+      vertex_format_(vertex_format),
+      vertex_streams_(vertex_streams) {
   CreatePipelineLayout();
   CreatePipeline(render_pass);
 };
@@ -41,29 +53,139 @@ void SimpleRendererSystem::CreatePipelineLayout() {
   }
 }
 
-// TODO: Provide old swap chain, to optimize by reusing resources from old swapchain and better transition to full screen.
+void SimpleRendererSystem::UpdateRenderPass(VkRenderPass render_pass, const RenderPassCompatibility &compatibility) {
+  if (compatibility == render_pass_compatibility_) {
+    return;
+  }
+  // Renderer already waited for the frames using the old pipeline when the formats changed.
+  render_pass_compatibility_ = compatibility;
+  // Released before asking the registry, the new render pass may reuse the old one's handle.
+  variant_pipelines_.clear();
+  lve_pipeline_ = nullptr;
+  CreatePipeline(render_pass);
+  // A reload in progress was built against the old render pass.
+  reloaded_pipeline_ = LvePipelineHandle{};
+}
+
+void SimpleRendererSystem::SetShaderVariant(const SimpleShaderConstants &constants) {
+  // Called per object, only look the pipeline up when the variant changes.
+  if (constants == shader_constants_) {
+    return;
+  }
+  shader_constants_ = constants;
+  SelectPipeline();
+}
+
+void SimpleRendererSystem::SetPipelineState(const DynamicPipelineState &state) {
+  if (state == pipeline_state_) {
+    return;
+  }
+  pipeline_state_ = state;
+  // Dynamic states all map to the pipeline already selected, only baked ones need another.
+  if (lve_device_.dynamicState().isComplete()) {
+    return;
+  }
+  SelectPipeline();
+}
+
+void SimpleRendererSystem::SelectPipeline() {
+  auto it = variant_pipelines_.find(LvePipelineRegistry::configKey(MakePipelineConfig(render_pass_)));
+  if (it != variant_pipelines_.end()) {
+    lve_pipeline_ = it->second;
+    return;
+  }
+  CreatePipeline(render_pass_);
+}
+
+void SimpleRendererSystem::OnShadersChanged(const std::vector<std::string> &changed_spv_files,
+                                            LvePipelineCompiler &compiler) {
+  for (const auto &file : changed_spv_files) {
+    if (file == kVertShaderPath || file == kFragShaderPath) {
+      // Queued behind(and superseding) a reload still compiling.
+      PipelineConfigInfo pipeline_config = MakePipelineConfig(render_pass_);
+      reloaded_variant_key_ = LvePipelineRegistry::configKey(pipeline_config);
+      reloaded_pipeline_ = compiler.compile({kVertShaderPath, kFragShaderPath, pipeline_config});
+      return;
+    }
+  }
+}
+
+std::vector<std::shared_ptr<LvePipeline>> SimpleRendererSystem::SwapReloadedPipeline() {
+  std::vector<std::shared_ptr<LvePipeline>> replaced;
+  if (!reloaded_pipeline_.isValid() || !reloaded_pipeline_.isReady()) {
+    return replaced;
+  }
+  std::shared_ptr<LvePipeline> reloaded;
+  try {
+    reloaded = reloaded_pipeline_.share();
+  } catch (const std::exception &e) {
+    std::cerr << "Shader reload failed, keeping the old pipeline: " << e.what() << "\n";
+  }
+  reloaded_pipeline_ = LvePipelineHandle{};
+  if (reloaded == nullptr) {
+    return replaced;
+  }
+  // Every other variant still uses the old shaders, they get rebuilt when selected again.
+  for (auto &variant : variant_pipelines_) {
+    replaced.push_back(std::move(variant.second));
+  }
+  variant_pipelines_.clear();
+  variant_pipelines_[reloaded_variant_key_] = reloaded;
+  lve_pipeline_ = nullptr;
+  // The variant may have changed while the reload was compiling.
+  SelectPipeline();
+  return replaced;
+}
+
 void SimpleRendererSystem::CreatePipeline(VkRenderPass render_pass) {
+  PipelineConfigInfo pipeline_config = MakePipelineConfig(render_pass);
+  // Shared with any other system asking for the same shaders and state.
+  lve_pipeline_ = lve_device_.pipelineRegistry().acquire(kVertShaderPath, kFragShaderPath, pipeline_config);
+  variant_pipelines_[LvePipelineRegistry::configKey(pipeline_config)] = lve_pipeline_;
+}
+
+PipelineConfigInfo SimpleRendererSystem::MakePipelineConfig(VkRenderPass render_pass) {
   // Checks that required swap chain and pipeline layout exist.
   assert(pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
+  render_pass_ = render_pass;
   PipelineConfigInfo pipeline_config{};
   LvePipeline::defaultPipelineConfigInfo(pipeline_config);
   // Renderpass is like a blueprint that tells graphic pipeline what layout is
   // expected for the output frame buffer and other info.
-  // Note: Now pipeline depends on this renderpass, but in the future
-  // if compatible, the pipeline can work with different swap chain and render pass.
-  // based on https://registry.khronos.org/vulkan/specs/1.1-extensions/html/chap8.html#renderpass-compatibility
-  // TODO: Optimize by checking if render pass is compatible with pipeline, if it is, don't need to recreate pipeline.
+  // The pipeline works with any render pass compatible with this one, see RenderPassCompatibility.
   pipeline_config.renderPass = render_pass;
+  pipeline_config.multisampleInfo.rasterizationSamples = render_pass_compatibility_.samples;
   pipeline_config.pipelineLayout = pipeline_layout_;
-  lve_pipeline_ = std::make_unique<LvePipeline>(lve_device_,
-                              "shaders/simple_shader.vert.spv",
-                              "shaders/simple_shader.frag.spv",
-                              pipeline_config);
+  pipeline_config.bindingDescriptions = LveModel::Vertex::getBindingDescriptions(vertex_format_, vertex_streams_);
+  pipeline_config.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions(vertex_format_, vertex_streams_);
+  // Same constants for both stages, each shader only declares the ids it uses.
+  pipeline_config.vertSpecialization.set(shader_constants_);
+  pipeline_config.fragSpecialization.set(shader_constants_);
+  // What the device can't set per draw stays baked in.
+  LveDynamicState::bake(pipeline_state_, pipeline_config);
+  lve_device_.dynamicState().makeDynamic(pipeline_config);
+  return pipeline_config;
 }
 
 void SimpleRendererSystem::RenderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject> &game_objects) {
-  lve_pipeline_->bind(command_buffer);
+  // Objects of the same variant and baked state share a pipeline, only bind when it changes.
+  LvePipeline *bound_pipeline = nullptr;
+  // Dynamic state stays set across binds(every pipeline here has the same dynamic states), only
+  // record it when it changes. Unset at the start of a command buffer.
+  const DynamicPipelineState *applied_state = nullptr;
+  // Models of one geometry pool share its buffers, only bind when switching pools.
+  LveGeometryPool *bound_geometry_pool = nullptr;
   for (auto & game_obj : game_objects){
+    SetShaderVariant(SimpleShaderConstants::fromMaterial(game_obj.material_));
+    SetPipelineState(game_obj.material_.pipelineState);
+    if (lve_pipeline_.get() != bound_pipeline) {
+      lve_pipeline_->bind(command_buffer);
+      bound_pipeline = lve_pipeline_.get();
+    }
+    if (applied_state == nullptr || *applied_state != pipeline_state_) {
+      lve_device_.dynamicState().apply(command_buffer, pipeline_state_);
+      applied_state = &game_obj.material_.pipelineState;
+    }
     SimplePushConstantData push_constant_data{};
     // Changing the rotation angle by 0.05 radians at every time step
     // and reset to 0 every time it reaches two_pi using mod.
@@ -73,7 +195,11 @@ void SimpleRendererSystem::RenderGameObjects(VkCommandBuffer command_buffer, std
     push_constant_data.transform = game_obj.transform2d_.transform();
     VkShaderStageFlags shader_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     vkCmdPushConstants(command_buffer, pipeline_layout_, shader_stages, /*offset*/ 0, /*size*/sizeof(SimplePushConstantData), &push_constant_data);
-    game_obj.lve_model_->bind(command_buffer);
+    LveGeometryPool *geometry_pool = game_obj.lve_model_->geometryPool();
+    if (geometry_pool == nullptr || geometry_pool != bound_geometry_pool) {
+      game_obj.lve_model_->bind(command_buffer);
+      bound_geometry_pool = geometry_pool;
+    }
     game_obj.lve_model_->draw(command_buffer);
   }
 }
@@ -1,29 +1,90 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_dynamic_state.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_registry.hpp"
 #include "lve_game_object.hpp"
 
 #include <iostream>
+#include <unordered_map>
 
 namespace lve {
+// Specialization constants of simple_shader, field i is `layout(constant_id = i)`.
+struct SimpleShaderConstants {
+  // 0 = per object color from the push constant, 1 = interpolated vertex color.
+  uint32_t colorMode = 0;
+  // VK_FALSE skips the 2x2 transform, for objects that are only translated.
+  VkBool32 applyTransform = VK_TRUE;
+
+  static SimpleShaderConstants fromMaterial(const MaterialComponent &material) {
+    return {material.vertexColors ? 1u : 0u, material.applyTransform ? VK_TRUE : VK_FALSE};
+  }
+  bool operator==(const SimpleShaderConstants &other) const {
+    return colorMode == other.colorMode && applyTransform == other.applyTransform;
+  }
+};
+
 class SimpleRendererSystem {
   public:
-    SimpleRendererSystem(LveDevice &device, VkRenderPass render_pass);
+    // vertex_format/vertex_streams are those of the models drawn, see LveModel::Builder::vertexFormat.
+    SimpleRendererSystem(LveDevice &device,
+                         VkRenderPass render_pass,
+                         const RenderPassCompatibility &compatibility,
+                         VertexFormat vertex_format = VertexFormat::kFloat32,
+                         VertexStreams vertex_streams = VertexStreams::kInterleaved);
     ~SimpleRendererSystem();
     SimpleRendererSystem(const SimpleRendererSystem &) = delete;
     SimpleRendererSystem &operator=(const SimpleRendererSystem &) = delete;
 
+    // Each object is drawn with the shader variant and pipeline state its material_ asks for.
     void RenderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject> &game_objects);
+    // Call with the renderer's current render pass before recording. The pipeline is only rebuilt
+    // when the render pass is incompatible(formats/samples changed), free on a plain resize.
+    void UpdateRenderPass(VkRenderPass render_pass, const RenderPassCompatibility &compatibility);
+
+    // Shader hot reload. Rebuilds the pipeline on compiler's workers if one of changed_spv_files is
+    // used by this system, the current pipeline keeps rendering meanwhile.
+    void OnShadersChanged(const std::vector<std::string> &changed_spv_files, LvePipelineCompiler &compiler);
+    // Call at the frame boundary(before recording). Swaps in the rebuilt pipeline once it's done
+    // and returns the replaced ones(every variant built from the old shaders), frames in flight
+    // may still use them, so hand them to LveRenderer::deferRelease.
+    std::vector<std::shared_ptr<LvePipeline>> SwapReloadedPipeline();
+
+    // Pipelines built so far, for the default and the drawn variants and states. One per variant
+    // with full extended dynamic state, one per variant and distinct state without it.
+    size_t PipelineCount() const { return variant_pipelines_.size(); }
   protected:
+    // Selects the shader variant of the following draws. Each variant is its own pipeline, built
+    // on first use and kept, so switching back and forth is free.
+    void SetShaderVariant(const SimpleShaderConstants &constants);
+    // Cull mode, depth test, blending etc. of the following draws. Only selects another pipeline
+    // for the states the device can't set per draw, like variants.
+    void SetPipelineState(const DynamicPipelineState &state);
     void CreatePipelineLayout();
     void CreatePipeline(VkRenderPass render_pass);
+    // Makes lve_pipeline_ the pipeline for the current variant and state, building it if needed.
+    void SelectPipeline();
+    PipelineConfigInfo MakePipelineConfig(VkRenderPass render_pass);
 
     LveDevice& lve_device_;
     // Using pointer for easy rather than stack allocated, makes it easy to point to new
     // swapchains. but slightly worst performance.
-    std::unique_ptr<LvePipeline> lve_pipeline_;
+    std::shared_ptr<LvePipeline> lve_pipeline_;
     VkPipelineLayout pipeline_layout_;
+    RenderPassCompatibility render_pass_compatibility_;
+    VkRenderPass render_pass_;
+    // Pipeline being rebuilt after a shader change, invalid when there's none.
+    LvePipelineHandle reloaded_pipeline_;
+    PipelineConfigKey reloaded_variant_key_;
+    SimpleShaderConstants shader_constants_;
+    VertexFormat vertex_format_;
+    VertexStreams vertex_streams_;
+    DynamicPipelineState pipeline_state_;
+    // Variants built from the current shaders and render pass, keyed by their full config
+    // (LvePipelineRegistry::configKey). lve_pipeline_ is one of them.
+    std::unordered_map<PipelineConfigKey, std::shared_ptr<LvePipeline>> variant_pipelines_;
 };
 
 }  // namespace lve
\ No newline at end of file
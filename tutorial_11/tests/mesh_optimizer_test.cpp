@@ -0,0 +1,159 @@
+// Checks of the lve_mesh_optimizer passes, no Vulkan needed. Built and run by `make check`.
+#include "lve_mesh_optimizer.hpp"
+
+// std headers
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failure_count = 0;
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << "\n";
+    failure_count++;
+  }
+}
+
+struct Mesh {
+  std::vector<float> positions;  // xyz per vertex.
+  std::vector<uint32_t> indices;
+};
+
+// UV sphere of segments x segments quads, 2 triangles each, wound counter-clockwise seen from
+// outside. The seam and pole vertices are duplicated, like a textured sphere would have them.
+Mesh GenerateSphereGrid(uint32_t segments, float radius) {
+  const float pi = 3.14159265358979f;
+  Mesh mesh{};
+  for (uint32_t row = 0; row <= segments; row++) {
+    float theta = pi * static_cast<float>(row) / static_cast<float>(segments);
+    for (uint32_t column = 0; column <= segments; column++) {
+      float phi = 2.0f * pi * static_cast<float>(column) / static_cast<float>(segments);
+      mesh.positions.push_back(radius * std::sin(theta) * std::cos(phi));
+      mesh.positions.push_back(radius * std::sin(theta) * std::sin(phi));
+      mesh.positions.push_back(radius * std::cos(theta));
+    }
+  }
+  for (uint32_t row = 0; row < segments; row++) {
+    for (uint32_t column = 0; column < segments; column++) {
+      uint32_t top_left = row * (segments + 1) + column;
+      uint32_t bottom_left = top_left + segments + 1;
+      mesh.indices.insert(mesh.indices.end(), {top_left, bottom_left, top_left + 1});
+      mesh.indices.insert(mesh.indices.end(), {top_left + 1, bottom_left, bottom_left + 1});
+    }
+  }
+  return mesh;
+}
+
+// Same triangles in a random order, what an unoptimized asset looks like to the cache.
+void ShuffleTriangles(std::vector<uint32_t> &indices, uint32_t seed) {
+  std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+  for (size_t t = 0; t < triangles.size(); t++) {
+    triangles[t] = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937{seed});
+  for (size_t t = 0; t < triangles.size(); t++) {
+    std::copy(triangles[t].begin(), triangles[t].end(), indices.begin() + 3 * t);
+  }
+}
+
+// Triangles rotated to start at their smallest index(keeps the winding), then sorted. Equal for
+// two index buffers drawing the same triangles in any order.
+std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const std::vector<uint32_t> &indices) {
+  std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+  for (size_t t = 0; t < triangles.size(); t++) {
+    std::array<uint32_t, 3> triangle = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    triangles[t] = triangle;
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+void TestVertexCacheAndOverdrawKeepTheTriangles() {
+  Mesh sphere = GenerateSphereGrid(100, 1.0f);
+  ShuffleTriangles(sphere.indices, 1);
+  const size_t vertex_count = sphere.positions.size() / 3;
+  const float acmr_shuffled = lve::computeAcmr(sphere.indices);
+
+  std::vector<uint32_t> cache_optimized = lve::optimizeVertexCache(sphere.indices, vertex_count);
+  Check(cache_optimized.size() == sphere.indices.size(), "optimizeVertexCache keeps the triangle count");
+  Check(CanonicalTriangles(cache_optimized) == CanonicalTriangles(sphere.indices),
+        "optimizeVertexCache only reorders the triangles");
+  const float acmr_cache = lve::computeAcmr(cache_optimized);
+  Check(acmr_cache < acmr_shuffled, "optimizeVertexCache lowers the ACMR of a shuffled mesh");
+
+  std::vector<uint32_t> overdraw_optimized = lve::optimizeOverdraw(cache_optimized, sphere.positions);
+  Check(overdraw_optimized.size() == sphere.indices.size(), "optimizeOverdraw keeps the triangle count");
+  Check(CanonicalTriangles(overdraw_optimized) == CanonicalTriangles(sphere.indices),
+        "optimizeOverdraw only reorders the triangles");
+  const float acmr_overdraw = lve::computeAcmr(overdraw_optimized);
+  Check(acmr_overdraw <= 1.05f * acmr_cache, "optimizeOverdraw stays within its ACMR threshold");
+  Check(acmr_overdraw <= acmr_shuffled, "the passes don't make the ACMR worse");
+
+  std::cout << "shuffled 100x100 sphere grid, " << sphere.indices.size() / 3 << " triangles: ACMR "
+            << acmr_shuffled << " -> " << acmr_cache << "(cache) -> " << acmr_overdraw << "(overdraw)\n";
+}
+
+void TestOverdrawDrawsOuterTrianglesFirst() {
+  // Inner sphere first in the input, the outer one hides it and should be drawn first.
+  Mesh inner = GenerateSphereGrid(20, 0.5f);
+  Mesh outer = GenerateSphereGrid(20, 1.0f);
+  Mesh mesh = inner;
+  const uint32_t outer_first_vertex = static_cast<uint32_t>(inner.positions.size() / 3);
+  mesh.positions.insert(mesh.positions.end(), outer.positions.begin(), outer.positions.end());
+  for (uint32_t index : outer.indices) {
+    mesh.indices.push_back(outer_first_vertex + index);
+  }
+
+  std::vector<uint32_t> optimized = lve::optimizeOverdraw(mesh.indices, mesh.positions);
+  Check(CanonicalTriangles(optimized) == CanonicalTriangles(mesh.indices),
+        "optimizeOverdraw only reorders the triangles of nested meshes");
+  const size_t outer_triangle_count = outer.indices.size() / 3;
+  bool outer_first = true;
+  for (size_t t = 0; t < outer_triangle_count; t++) {
+    outer_first = outer_first && optimized[3 * t] >= outer_first_vertex;
+  }
+  Check(outer_first, "optimizeOverdraw draws the outer sphere before the inner one");
+}
+
+void TestOverdrawKeepsFlatMeshes() {
+  // z = 0 everywhere, nothing occludes anything.
+  Mesh sphere = GenerateSphereGrid(10, 1.0f);
+  for (size_t v = 0; v < sphere.positions.size() / 3; v++) {
+    sphere.positions[3 * v + 2] = 0.0f;
+  }
+  Check(lve::optimizeOverdraw(sphere.indices, sphere.positions) == sphere.indices,
+        "optimizeOverdraw keeps the order of flat meshes");
+}
+
+void TestVertexFetchRenumbersInFirstUseOrder() {
+  std::vector<uint32_t> indices = {4, 2, 0, 2, 4, 5};
+  std::vector<uint32_t> remap = lve::optimizeVertexFetch(indices, 6);
+  Check(indices == std::vector<uint32_t>({0, 1, 2, 1, 0, 3}), "optimizeVertexFetch renumbers in first use order");
+  Check(remap == std::vector<uint32_t>({2, lve::kUnusedVertex, 1, lve::kUnusedVertex, 0, 3}),
+        "optimizeVertexFetch maps unused vertices to kUnusedVertex");
+  std::vector<char> vertices = {'a', 'b', 'c', 'd', 'e', 'f'};
+  Check(lve::remapVertices(vertices, remap) == std::vector<char>({'e', 'c', 'a', 'f'}),
+        "remapVertices drops unused vertices");
+}
+
+}  // namespace
+
+int main() {
+  TestVertexCacheAndOverdrawKeepTheTriangles();
+  TestOverdrawDrawsOuterTrianglesFirst();
+  TestOverdrawKeepsFlatMeshes();
+  TestVertexFetchRenumbersInFirstUseOrder();
+  if (failure_count > 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << "mesh_optimizer_test passed\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// Checks of the lve_vertex_format encoders, no Vulkan needed. Built and run by `make check`.
+#include "lve_vertex_format.hpp"
+
+// std headers
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failure_count = 0;
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << "\n";
+    failure_count++;
+  }
+}
+
+// Inside, outside and exactly on the clamping range, plus the rounding ties of both scales.
+std::vector<float> TestValues() {
+  std::vector<float> values = {0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 2.0f, -2.0f, 1e-6f, -1e-6f,
+                               0.5f / 32767.0f, 1.5f / 32767.0f, 0.5f / 255.0f, 1.5f / 255.0f,
+                               std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+  std::mt19937 random{1};
+  std::uniform_real_distribution<float> distribution{-1.5f, 1.5f};
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(distribution(random));
+  }
+  return values;
+}
+
+// Batches go through the SSE2 loops(8/16 values at a time), single values through the scalar
+// tail. Both have to give the same bits.
+void TestBatchMatchesScalar() {
+  const std::vector<float> values = TestValues();
+  std::vector<int16_t> snorm_batch(values.size());
+  lve::packSnorm16(values.data(), values.size(), snorm_batch.data());
+  std::vector<uint8_t> unorm_batch(values.size());
+  lve::packUnorm8(values.data(), values.size(), unorm_batch.data());
+  bool snorm_matches = true;
+  bool unorm_matches = true;
+  for (size_t i = 0; i < values.size(); i++) {
+    int16_t snorm;
+    lve::packSnorm16(&values[i], 1, &snorm);
+    snorm_matches = snorm_matches && snorm == snorm_batch[i];
+    uint8_t unorm;
+    lve::packUnorm8(&values[i], 1, &unorm);
+    unorm_matches = unorm_matches && unorm == unorm_batch[i];
+  }
+  Check(snorm_matches, "packSnorm16 batches match single values");
+  Check(unorm_matches, "packUnorm8 batches match single values");
+}
+
+void TestSnormUnormValues() {
+  const float values[] = {-2.0f, -1.0f, 0.0f, 0.5f, 1.0f, 2.0f, 1.5f / 32767.0f, 2.5f / 32767.0f};
+  int16_t snorm[8];
+  lve::packSnorm16(values, 8, snorm);
+  Check(snorm[0] == -32767 && snorm[1] == -32767 && snorm[2] == 0 && snorm[3] == 16384 &&
+            snorm[4] == 32767 && snorm[5] == 32767,
+        "packSnorm16 clamps and scales by 32767");
+  Check(snorm[6] == 2 && snorm[7] == 2, "packSnorm16 rounds ties to even");
+  uint8_t unorm[8];
+  lve::packUnorm8(values, 8, unorm);
+  Check(unorm[0] == 0 && unorm[1] == 0 && unorm[2] == 0 && unorm[3] == 128 && unorm[4] == 255 &&
+            unorm[5] == 255,
+        "packUnorm8 clamps and scales by 255");
+}
+
+void TestHalfValues() {
+  const float values[] = {0.0f, -0.0f, 1.0f, -2.0f, 65504.0f, 65520.0f, 1e-8f,
+                          std::ldexp(1.0f, -24), std::numeric_limits<float>::infinity(),
+                          1.0f + std::ldexp(1.0f, -11), 1.0f + 3.0f * std::ldexp(1.0f, -11)};
+  const uint16_t expected[] = {0x0000, 0x8000, 0x3c00, 0xc000, 0x7bff, 0x7c00, 0x0000,
+                               0x0001, 0x7c00, 0x3c00, 0x3c02};
+  uint16_t half[11];
+  lve::packHalf(values, 11, half);
+  bool matches = true;
+  for (int i = 0; i < 11; i++) {
+    matches = matches && half[i] == expected[i];
+  }
+  Check(matches, "packHalf gives IEEE half bits, rounding ties to even");
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  uint16_t half_nan;
+  lve::packHalf(&nan, 1, &half_nan);
+  Check((half_nan & 0x7c00) == 0x7c00 && (half_nan & 0x03ff) != 0, "packHalf keeps NaN a NaN");
+}
+
+void TestOctahedral() {
+  lve::Snorm16x2 zero = lve::packOctahedralSnorm16(0.0f, 0.0f, 0.0f);
+  Check(zero.x == 0 && zero.y == 0, "packOctahedralSnorm16 maps a zero vector to (0, 0)");
+  lve::Snorm16x2 up = lve::packOctahedralSnorm16(0.0f, 0.0f, 1.0f);
+  Check(up.x == 0 && up.y == 0, "packOctahedralSnorm16 maps +z to the center");
+  lve::Snorm16x2 x = lve::packOctahedralSnorm16(1.0f, 0.0f, 0.0f);
+  Check(x.x == 32767 && x.y == 0, "packOctahedralSnorm16 maps +x to the edge");
+  lve::Snorm16x2 down = lve::packOctahedralSnorm16(0.0f, 0.0f, -1.0f);
+  Check(std::abs(down.x) == 32767 && std::abs(down.y) == 32767, "packOctahedralSnorm16 folds -z to a corner");
+}
+
+}  // namespace
+
+int main() {
+  TestBatchMatchesScalar();
+  TestSnormUnormValues();
+  TestHalfValues();
+  TestOctahedral();
+  if (failure_count > 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << "vertex_format_test passed\n";
+  return EXIT_SUCCESS;
+}